@@ -0,0 +1,545 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aot.h"
+#include "jit.h"
+#include "opcodes.h"
+
+// The translator follows the code from the reset, nmi and irq vectors, through fallthroughs, branches, jmp and jsr,
+// and writes out a c function for every block it finds. For UxROM it does this once for every bank that can be
+// switched into $8000-$bfff, so code in the fixed bank that calls into any of them is followed.
+//
+// A translated block is the same list of instruction calls the interpreter would make, with the opcode, addressing
+// mode and operand fixed, so the compiler can inline the instructions from instructions.h and fold away the
+// addressing modes. Like the jit's blocks, it keeps count of the cycles and leaves once the budget has run out.
+// cpu->cycles is brought up to date before any instruction that could touch the ppu, apu, controllers or mapper,
+// which lets them run inside the block (see tickPpu()).
+//
+// Blocks are found by where they are in PRG-ROM rather than by cpu address, so one that the tracing got wrong (say,
+// data that was followed as code) is still the right translation of those bytes and is just never run.
+//
+// A block ends:
+//   - on any branch, jump, call, return or brk
+//   - after a store that could have written to a mapper register, since it could have switched banks
+//   - before an illegal opcode, or where the code runs off the end of the PRG bank
+//
+// Branches and fallthroughs into another translated block of the same bank call it directly, as do jmp and jsr
+// once they've checked the bank holding the target is still mapped in. Everything else goes back to jitExecute().
+
+
+#define AOT_NAME_ENTRY(opcode, instruction, mode, cycles) [opcode] = #instruction,
+#define AOT_MODE_ENTRY(opcode, instruction, mode, cycles) [opcode] = mode,
+#define AOT_MODE_NAME_ENTRY(opcode, instruction, mode, cycles) [opcode] = #mode,
+
+static const char* const aotNames[256] = {
+  OPCODE_LIST(AOT_NAME_ENTRY)
+};
+
+static const AddrMode aotModes[256] = {
+  OPCODE_LIST(AOT_MODE_ENTRY)
+};
+
+static const char* const aotModeNames[256] = {
+  OPCODE_LIST(AOT_MODE_NAME_ENTRY)
+};
+
+
+// the table built in with make AOT=FILE, if there is one
+#if AOT_BUILTIN == 1
+extern const AotTable aotTable;
+#define AOT_TABLE (&aotTable)
+#else
+#define AOT_TABLE NULL
+#endif
+
+
+// endsBlock()
+//   instructions that change the program counter
+static int endsBlock(uint8_t oppCode){
+  return aotModes[oppCode] == relative || strcmp(aotNames[oppCode], "jmp") == 0 || strcmp(aotNames[oppCode], "jsr") == 0 ||
+         strcmp(aotNames[oppCode], "rts") == 0 || strcmp(aotNames[oppCode], "rti") == 0 || strcmp(aotNames[oppCode], "brk") == 0;
+}
+
+// writesMemory()
+//   stores and read-modify-write instructions that don't work on the accumulator
+static int writesMemory(uint8_t oppCode){
+  const char* writers[] = {"sta", "stx", "sty", "asl", "lsr", "rol", "ror", "inc", "dec"};
+  if(aotModes[oppCode] == accumulator){
+    return 0;
+  }
+  for(int i = 0; i < (int)(sizeof(writers) / sizeof(writers[0])); ++i){
+    if(strcmp(aotNames[oppCode], writers[i]) == 0){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// accessRange()
+//   the addresses the instruction could read or write through its operand, from start to start + length - 1.
+//   returns 0 if it doesn't access memory through its operand (or only the zero page), -1 if it could be anywhere
+static int accessRange(uint8_t oppCode, uint16_t operand, uint32_t* start, uint32_t* length){
+  if(strcmp(aotNames[oppCode], "jmp") == 0 && aotModes[oppCode] == absolute){
+    return 0;
+  }
+  if(strcmp(aotNames[oppCode], "jsr") == 0){
+    return 0;
+  }
+
+  switch(aotModes[oppCode]){
+    case absolute:
+      *start = operand;
+      *length = 1;
+      return 1;
+    case absoluteX:
+    case absoluteY:
+      *start = operand;
+      *length = 0x100;
+      return 1;
+    case absoluteIndir:
+      // the pointer never leaves its page
+      *start = operand & 0xff00;
+      *length = 0x100;
+      return 1;
+    case indirectX:
+    case indirectY:
+      return -1;
+    default:
+      return 0;
+  }
+}
+
+// touchesIo()
+//   whether the instruction could read the ppu/apu/controller registers, or write to them or to a mapper register
+static int touchesIo(uint8_t oppCode, uint16_t operand){
+  uint32_t start, length, addr;
+  int write = writesMemory(oppCode);
+  int range = accessRange(oppCode, operand, &start, &length);
+
+  if(range != 1){
+    return range == -1;
+  }
+  for(uint32_t i = 0; i < length; ++i){
+    addr = (start + i) & 0xffff;
+    if(addr >= 0x2000 && addr <= 0x401f){
+      return 1;
+    }
+    if(write && addr >= 0x4020){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// writesMapper()
+//   whether the instruction could write to a mapper register ($8000-$ffff)
+static int writesMapper(uint8_t oppCode, uint16_t operand){
+  uint32_t start, length;
+  int range;
+
+  if(!writesMemory(oppCode)){
+    return 0;
+  }
+  range = accessRange(oppCode, operand, &start, &length);
+  if(range == -1){
+    return 1;
+  }
+  return range == 1 && (start + length - 1 >= 0x8000);
+}
+
+
+// operandAt()
+//   the operand bytes of the instruction at offset in a memory block, little endian
+static uint16_t operandAt(Mem* mem, int offset){
+  uint16_t operand = 0;
+  if(opLength[mem->contents[offset]] > 1){
+    operand = mem->contents[offset + 1];
+  }
+  if(opLength[mem->contents[offset]] > 2){
+    operand |= ((uint16_t)mem->contents[offset + 2]) << 8;
+  }
+  return operand;
+}
+
+// scanBlock()
+//   finds where the block starting at offset ends. returns the number of instructions in it, with the offset of the last
+//   one in last and the offset just past it in end
+static int scanBlock(Mem* mem, int offset, int* last, int* end){
+  int count = 0;
+  uint8_t oppCode;
+
+  *end = offset;
+  while(count < AOT_MAX_INSTRUCTIONS){
+    oppCode = mem->contents[*end];
+    if(decodedOpTable[oppCode] == NULL || *end + opLength[oppCode] > mem->size){
+      break;
+    }
+    *last = *end;
+    *end += opLength[oppCode];
+    count++;
+
+    if(endsBlock(oppCode) || writesMapper(oppCode, operandAt(mem, *last))){
+      break;
+    }
+  }
+  return count;
+}
+
+// locate()
+//   the PRG-ROM block and offset into it that the cpu sees at addr with the banks that are currently mapped in.
+//   returns 0 if addr isn't PRG-ROM
+static int locate(Bus* bus, uint16_t addr, int* block, int* offset){
+  uint8_t* page = bus->readPages[addr >> 8];
+  Mem* mem;
+
+  if(page == NULL){
+    return 0;
+  }
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    mem = &bus->memArr[i];
+    if(mem->type == Rom && mem->contents != NULL && page >= mem->contents && page < mem->contents + mem->size){
+      *block = i;
+      *offset = (page - mem->contents) + (addr & 0xff);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+// traceCode()
+//   follows the code from the vectors with the banks that are currently mapped in, marking the start of every block found
+//   in starts. addrs is set to the cpu address each block was first found at
+static void traceCode(Bus* bus, uint8_t** starts, uint16_t** addrs){
+  uint8_t* seen = calloc(0x10000, 1);
+  uint16_t* stack = malloc(0x30000 * sizeof(uint16_t));
+  int top = 0;
+  uint16_t addr, next;
+  int block, offset, last, end;
+  uint8_t oppCode;
+  uint16_t operand;
+  Mem* mem;
+
+  for(int vector = 0xfffa; vector <= 0xfffe; vector += 2){
+    stack[top++] = readBus(bus, vector) | (readBus(bus, vector + 1) << 8);
+  }
+
+  while(top > 0){
+    addr = stack[--top];
+    if(seen[addr] != 0){
+      continue;
+    }
+    seen[addr] = 1;
+
+    if(locate(bus, addr, &block, &offset) == 0){
+      continue;
+    }
+    mem = &bus->memArr[block];
+    if(scanBlock(mem, offset, &last, &end) == 0){
+      continue;
+    }
+    if(starts[block][offset] == 0){
+      starts[block][offset] = 1;
+      addrs[block][offset] = addr;
+    }
+
+    oppCode = mem->contents[last];
+    operand = operandAt(mem, last);
+    next = addr + (end - offset);
+
+    if(aotModes[oppCode] == relative){
+      stack[top++] = next;
+      stack[top++] = next + (int8_t)operand;
+    } else if(strcmp(aotNames[oppCode], "jsr") == 0){
+      stack[top++] = next;
+      stack[top++] = operand;
+    } else if(strcmp(aotNames[oppCode], "jmp") == 0){
+      if(aotModes[oppCode] == absolute){
+        stack[top++] = operand;
+      }
+    } else if(!endsBlock(oppCode)){
+      stack[top++] = next;
+    }
+  }
+
+  free(seen);
+  free(stack);
+}
+
+
+// prgHash()
+//   fnv-1a hash of the mapper and every PRG-ROM block, so that translated blocks are only used with the rom they came from
+static uint64_t prgHash(Bus* bus){
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  hash = (hash ^ (uint8_t)bus->mapper) * 0x100000001b3ULL;
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    if(bus->memArr[i].type != Rom || bus->memArr[i].contents == NULL){
+      continue;
+    }
+    for(int j = 0; j < bus->memArr[i].size; ++j){
+      hash = (hash ^ bus->memArr[i].contents[j]) * 0x100000001b3ULL;
+    }
+  }
+  return hash;
+}
+
+
+// emitCall()
+//   writes out a call to the translated block at offset, leaving the block with the cycles of both
+static void emitCall(FILE* out, const char* indent, int block, int offset){
+  fprintf(out, "%sreturn cycles + aotBlock%d_%04x(cpu, bus, budget - cycles);\n", indent, block, offset);
+}
+
+// emitBlock()
+//   writes out the c for the block at offset into a PRG-ROM block
+static void emitBlock(FILE* out, Bus* bus, int block, int offset, uint8_t** starts, uint16_t** addrs){
+  Mem* mem = &bus->memArr[block];
+  int last, end, o;
+  int count = scanBlock(mem, offset, &last, &end);
+  uint8_t oppCode = mem->contents[last];
+  uint16_t operand = operandAt(mem, last);
+  int target = -1;
+  int fallthrough = -1;
+  int chained;
+  int branch;
+  int io = 0;
+
+  // where the block can carry straight on into another one
+  if(aotModes[oppCode] == relative){
+    fallthrough = end;
+    target = end + (int8_t)operand;
+  } else if((strcmp(aotNames[oppCode], "jmp") == 0 && aotModes[oppCode] == absolute) || strcmp(aotNames[oppCode], "jsr") == 0){
+    target = (int)last + (operand - (addrs[block][offset] + (last - offset)));
+  } else if(!endsBlock(oppCode) && !writesMapper(oppCode, operand)){
+    fallthrough = end;
+  }
+  if(target < 0 || target >= mem->size || starts[block][target] == 0){
+    target = -1;
+  }
+  if(fallthrough >= mem->size || (fallthrough >= 0 && starts[block][fallthrough] == 0)){
+    fallthrough = -1;
+  }
+  chained = target != -1 || fallthrough != -1;
+
+  // a branch that can go to two different blocks has to check which way it went
+  branch = aotModes[oppCode] == relative && chained && target != fallthrough;
+
+  // start is only needed to bring cpu->cycles up to date, before touching io or going on to another block
+  o = offset;
+  for(int i = 0; i < count; ++i){
+    io |= touchesIo(mem->contents[o], operandAt(mem, o));
+    o += opLength[mem->contents[o]];
+  }
+
+  fprintf(out, "// $%04x\n", addrs[block][offset]);
+  fprintf(out, "static int aotBlock%d_%04x(CPU* cpu, Bus* bus, int budget){\n", block, offset);
+  if(io || chained){
+    fprintf(out, "  int start = cpu->cycles;\n");
+  }
+  fprintf(out, "  int cycles = 0;\n");
+  if(branch){
+    fprintf(out, "  uint16_t next;\n");
+  }
+  fprintf(out, "\n");
+
+  o = offset;
+  for(int i = 0; i < count; ++i){
+    oppCode = mem->contents[o];
+    operand = operandAt(mem, o);
+
+    if(i == count - 1 && branch){
+      fprintf(out, "  next = cpu->pc + 2;\n");
+    }
+    if(touchesIo(oppCode, operand)){
+      fprintf(out, "  cpu->cycles = start + cycles;\n");
+    }
+    fprintf(out, "  cycles += %d + %s(cpu, bus, %s, 0x%04x);\n", opCycles[oppCode], aotNames[oppCode], aotModeNames[oppCode], operand);
+    if(i != count - 1 || chained){
+      fprintf(out, "  if(cycles >= budget){\n    return cycles;\n  }\n");
+    }
+    o += opLength[oppCode];
+  }
+
+  if(chained){
+    fprintf(out, "\n  cpu->cycles = start + cycles;\n");
+  }
+  if(branch){
+    if(target != -1){
+      fprintf(out, "  if(cpu->pc != next){\n");
+      emitCall(out, "    ", block, target);
+      fprintf(out, "  }\n");
+    }
+    if(fallthrough != -1 && target == -1){
+      fprintf(out, "  if(cpu->pc == next){\n");
+      emitCall(out, "    ", block, fallthrough);
+      fprintf(out, "  }\n");
+      fallthrough = -1;
+    }
+  } else if(target != -1 && aotModes[oppCode] != relative){
+    // jmp or jsr, only if the bank the target is in is still the one mapped in.
+    // a branch whose target is its fallthrough just carries on below
+    fprintf(out, "  if(bus->jitPages[0x%02x] == bus->memArr[%d].jitBlocks + 0x%04x){\n", operand >> 8, block, target & ~0xff);
+    emitCall(out, "    ", block, target);
+    fprintf(out, "  }\n");
+  }
+  if(fallthrough != -1){
+    emitCall(out, "  ", block, fallthrough);
+  } else {
+    fprintf(out, "  return cycles;\n");
+  }
+  fprintf(out, "}\n\n");
+}
+
+
+// aotTranslate()
+//   translates the PRG-ROM on the bus into c, written to fileName. only mappers 0, 2 and 3 are supported.
+//   returns 1 on success, 0 otherwise
+int aotTranslate(Bus* bus, char* fileName){
+  uint8_t** starts;
+  uint16_t** addrs;
+  uint8_t bankSelect = bus->bankSelect;
+  int numOfBlocks = 0;
+  FILE* out;
+
+  if(bus->mapper != 0 && bus->mapper != 2 && bus->mapper != 3){
+    printf("aot: only mappers 0, 2 and 3 can be translated \n");
+    return 0;
+  }
+
+  out = fopen(fileName, "w");
+  if(out == NULL){
+    printf("aot: could not open %s \n", fileName);
+    return 0;
+  }
+
+  starts = calloc(bus->numOfBlocks, sizeof(uint8_t*));
+  addrs = calloc(bus->numOfBlocks, sizeof(uint16_t*));
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    if(bus->memArr[i].type == Rom && bus->memArr[i].contents != NULL){
+      starts[i] = calloc(bus->memArr[i].size, 1);
+      addrs[i] = calloc(bus->memArr[i].size, sizeof(uint16_t));
+    }
+  }
+
+  // UxROM is followed once with each bank switched in, CNROM only switches CHR
+  if(bus->mapper == 2){
+    for(int i = 0; i < bus->numOfBlocks - 1; ++i){
+      bus->bankSelect = i;
+      updatePageTable(bus);
+      traceCode(bus, starts, addrs);
+    }
+    bus->bankSelect = bankSelect;
+    updatePageTable(bus);
+  } else {
+    traceCode(bus, starts, addrs);
+  }
+
+  fprintf(out, "// translated from the PRG-ROM of a mapper %d rom by ernes --translate, build it in with make AOT=%s\n", bus->mapper, fileName);
+  fprintf(out, "// and run the rom with -A\n\n");
+  fprintf(out, "#include \"aot.h\"\n");
+  fprintf(out, "#include \"instructions.h\"\n\n\n");
+
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    for(int j = 0; starts[i] != NULL && j < bus->memArr[i].size; ++j){
+      if(starts[i][j] != 0){
+        fprintf(out, "static int aotBlock%d_%04x(CPU*, Bus*, int);\n", i, j);
+        numOfBlocks++;
+      }
+    }
+  }
+  fprintf(out, "\n\n");
+
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    for(int j = 0; starts[i] != NULL && j < bus->memArr[i].size; ++j){
+      if(starts[i][j] != 0){
+        emitBlock(out, bus, i, j, starts, addrs);
+      }
+    }
+  }
+
+  fprintf(out, "\nstatic const AotBlock blocks[] = {\n");
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    for(int j = 0; starts[i] != NULL && j < bus->memArr[i].size; ++j){
+      if(starts[i][j] != 0){
+        fprintf(out, "  {%d, 0x%04x, aotBlock%d_%04x},\n", i, j, i, j);
+      }
+    }
+  }
+  fprintf(out, "};\n\n");
+  fprintf(out, "const AotTable aotTable = {0x%016llxULL, %d, blocks};\n", (unsigned long long)prgHash(bus), numOfBlocks);
+
+  fclose(out);
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    free(starts[i]);
+    free(addrs[i]);
+  }
+  free(starts);
+  free(addrs);
+
+  printf("aot: translated %d blocks into %s \n", numOfBlocks, fileName);
+  return 1;
+}
+
+
+// initAot()
+//   puts the blocks built in with make AOT=FILE into the jit's table for the PRG-ROM on the bus, setting the table up
+//   without the jit if it isn't already. has to be called after the memory blocks have been allocated.
+//   if check is 1, every block is run against the interpreter as well (slow).
+//   returns 1 on success, 0 if there aren't any blocks for this rom
+int initAot(Bus* bus, int check){
+  const AotTable* table = AOT_TABLE;
+  const AotBlock* aotBlock;
+  Mem* mem;
+
+  if(table == NULL){
+    printf("aot: no translated blocks have been built in, see --translate \n");
+    return 0;
+  }
+  if(table->prgHash != prgHash(bus)){
+    printf("aot: the translated blocks that have been built in are for a different rom \n");
+    return 0;
+  }
+
+  if(bus->jit == NULL){
+    initJitBlocks(bus, check);
+  }
+
+  for(int i = 0; i < table->numOfBlocks; ++i){
+    aotBlock = &table->blocks[i];
+    if(aotBlock->block >= bus->numOfBlocks){
+      continue;
+    }
+    mem = &bus->memArr[aotBlock->block];
+    if(mem->jitBlocks != NULL && aotBlock->offset < mem->size){
+      mem->jitBlocks[aotBlock->offset] = aotBlock->run;
+    }
+  }
+
+  printf("aot: %d translated blocks \n", table->numOfBlocks);
+  return 1;
+}
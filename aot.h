@@ -0,0 +1,61 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+
+#pragma once
+#include <stdint.h>
+#include "cpu.h"
+#include "memory.h"
+
+// aot.h
+//   translates the PRG-ROM of NROM, UxROM and CNROM games (mappers 0, 2 and 3) into c ahead of time, one function
+//   per block of code that can be reached from the reset, nmi and irq vectors.
+//   the c is built into the emulator with make AOT=FILE, and its blocks are run in the same way as the jit's
+//   (see jitExecute()). anything that wasn't translated is interpreted, or compiled by the jit with -J
+
+
+// AOT_MAX_INSTRUCTIONS
+//   the most instructions that get translated into a single block
+#define AOT_MAX_INSTRUCTIONS 64
+
+
+typedef struct _AotBlock {
+  // index into Bus.memArr, and the offset into it, of the first instruction of the block
+  int block;
+  int offset;
+
+  JitBlock run;
+} AotBlock;
+
+// the blocks generated by --translate for one rom
+typedef struct _AotTable {
+  // hash of the PRG-ROM the blocks were translated from, see prgHash()
+  uint64_t prgHash;
+
+  int numOfBlocks;
+  const AotBlock* blocks;
+} AotTable;
+
+
+int aotTranslate(Bus*, char*);
+int initAot(Bus*, int);
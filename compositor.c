@@ -0,0 +1,277 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compositor.h"
+#include "general.h"
+#include "ppu.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define COMPOSITOR_X86 1
+#include <immintrin.h>
+#else
+#define COMPOSITOR_X86 0
+#endif
+
+
+CompositeFunc compositeScanline = compositeScanlineScalar;
+
+
+// compositeScanlineScalar()
+//   one pixel at a time. a sprite pixel is drawn over the background unless it's transparent, or it's behind
+//   the background and the background is opaque
+int compositeScanlineScalar(const uint8_t* background, const uint8_t* sprites, uint8_t* out, int from){
+  uint8_t bg;
+  uint8_t sprite;
+  int hit = -1;
+
+  for(int i = from; i < WINDOW_WIDTH; ++i){
+    // $3f00 is hard-wired to be the backdrop color
+    bg = background[i];
+    if((bg & 0b11) == 0){
+      bg = 0;
+    }
+
+    out[i] = bg;
+    sprite = sprites[i];
+    if(sprite != 0){
+      if(bg == 0 || (sprite & SPRITE_PIXEL_BEHIND) == 0){
+        out[i] = sprite & SPRITE_PIXEL_COLOUR;
+      }
+
+      // sprite zero hit detection
+      if((sprite & SPRITE_PIXEL_ZERO) != 0 && bg != 0 && i != 255 && hit == -1){
+        hit = i;
+      }
+    }
+  }
+
+  return hit;
+}
+
+
+#if COMPOSITOR_X86 == 1
+
+// compositeScanlineSse2()
+//   same as compositeScanlineScalar(), 16 pixels at a time
+int compositeScanlineSse2(const uint8_t* background, const uint8_t* sprites, uint8_t* out, int from){
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i colourBits = _mm_set1_epi8(0b11);
+  const __m128i colourMask = _mm_set1_epi8(SPRITE_PIXEL_COLOUR);
+  const __m128i behindMask = _mm_set1_epi8(SPRITE_PIXEL_BEHIND);
+  const __m128i zeroMask = _mm_set1_epi8(SPRITE_PIXEL_ZERO);
+  __m128i bg;
+  __m128i sprite;
+  __m128i bgClear;
+  __m128i spriteShown;
+  __m128i hits;
+  int hitBits;
+  int hit = -1;
+
+  for(int i = from & ~15; i < WINDOW_WIDTH; i += 16){
+    bg = _mm_loadu_si128((const __m128i*)(background + i));
+    sprite = _mm_loadu_si128((const __m128i*)(sprites + i));
+
+    // 0xff where the background is transparent, which then becomes the backdrop colour 0
+    bgClear = _mm_cmpeq_epi8(_mm_and_si128(bg, colourBits), zero);
+    bg = _mm_andnot_si128(bgClear, bg);
+
+    // shown if opaque and (in front of the background, or the background is transparent)
+    spriteShown = _mm_andnot_si128(_mm_cmpeq_epi8(sprite, zero),
+                                   _mm_or_si128(bgClear, _mm_cmpeq_epi8(_mm_and_si128(sprite, behindMask), zero)));
+    _mm_storeu_si128((__m128i*)(out + i),
+                     _mm_or_si128(_mm_and_si128(spriteShown, _mm_and_si128(sprite, colourMask)), _mm_andnot_si128(spriteShown, bg)));
+
+    // sprite 0 pixels over an opaque background
+    hits = _mm_andnot_si128(bgClear, _mm_cmpeq_epi8(_mm_and_si128(sprite, zeroMask), zeroMask));
+    hitBits = _mm_movemask_epi8(hits) & (i == WINDOW_WIDTH - 16 ? 0x7fff : 0xffff);
+    if(i < from){
+      hitBits &= ~((1 << (from - i)) - 1);
+    }
+    if(hitBits != 0 && hit == -1){
+      hit = i + __builtin_ctz(hitBits);
+    }
+  }
+
+  return hit;
+}
+
+
+// compositeScanlineAvx2()
+//   same as compositeScanlineScalar(), 32 pixels at a time
+__attribute__((target("avx2")))
+int compositeScanlineAvx2(const uint8_t* background, const uint8_t* sprites, uint8_t* out, int from){
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i colourBits = _mm256_set1_epi8(0b11);
+  const __m256i colourMask = _mm256_set1_epi8(SPRITE_PIXEL_COLOUR);
+  const __m256i behindMask = _mm256_set1_epi8(SPRITE_PIXEL_BEHIND);
+  const __m256i zeroMask = _mm256_set1_epi8(SPRITE_PIXEL_ZERO);
+  __m256i bg;
+  __m256i sprite;
+  __m256i bgClear;
+  __m256i spriteShown;
+  __m256i hits;
+  uint32_t hitBits;
+  int hit = -1;
+
+  for(int i = from & ~31; i < WINDOW_WIDTH; i += 32){
+    bg = _mm256_loadu_si256((const __m256i*)(background + i));
+    sprite = _mm256_loadu_si256((const __m256i*)(sprites + i));
+
+    bgClear = _mm256_cmpeq_epi8(_mm256_and_si256(bg, colourBits), zero);
+    bg = _mm256_andnot_si256(bgClear, bg);
+
+    spriteShown = _mm256_andnot_si256(_mm256_cmpeq_epi8(sprite, zero),
+                                      _mm256_or_si256(bgClear, _mm256_cmpeq_epi8(_mm256_and_si256(sprite, behindMask), zero)));
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_blendv_epi8(bg, _mm256_and_si256(sprite, colourMask), spriteShown));
+
+    hits = _mm256_andnot_si256(bgClear, _mm256_cmpeq_epi8(_mm256_and_si256(sprite, zeroMask), zeroMask));
+    hitBits = (uint32_t)_mm256_movemask_epi8(hits) & (i == WINDOW_WIDTH - 32 ? 0x7fffffffu : 0xffffffffu);
+    if(i < from){
+      hitBits &= ~((1u << (from - i)) - 1);
+    }
+    if(hitBits != 0 && hit == -1){
+      hit = i + __builtin_ctz(hitBits);
+    }
+  }
+
+  return hit;
+}
+
+#endif
+
+
+// initCompositor()
+//   picks the compositor that renderScanline() uses. COMPOSITOR_AUTO picks the fastest one the cpu supports,
+//   asking for one that isn't supported falls back to the scalar version.
+//   returns the type picked
+int initCompositor(int type){
+#if COMPOSITOR_X86 == 1
+  __builtin_cpu_init();
+  if(type == COMPOSITOR_AUTO){
+    type = __builtin_cpu_supports("avx2") ? COMPOSITOR_AVX2 : COMPOSITOR_SSE2;
+  }
+  if(type == COMPOSITOR_AVX2 && !__builtin_cpu_supports("avx2")){
+    type = COMPOSITOR_SCALAR;
+  }
+
+  switch(type){
+    case COMPOSITOR_SSE2:
+      compositeScanline = compositeScanlineSse2;
+      return type;
+    case COMPOSITOR_AVX2:
+      compositeScanline = compositeScanlineAvx2;
+      return type;
+  }
+#endif
+
+  compositeScanline = compositeScanlineScalar;
+  return COMPOSITOR_SCALAR;
+}
+
+
+const char* compositorName(int type){
+  switch(type){
+    case COMPOSITOR_SSE2:
+      return "sse2";
+    case COMPOSITOR_AVX2:
+      return "avx2";
+    case COMPOSITOR_SCALAR:
+      return "scalar";
+  }
+  return "auto";
+}
+
+
+// checkCompositors()
+//   runs random lines through every compositor the cpu supports, starting from every pixel, and compares the
+//   pixels and sprite 0 hit against compositeScanlineScalar()
+//   inputs:
+//     numOfLines - number of random lines to try
+//   return:
+//     number of mismatches, printing each one
+int checkCompositors(int numOfLines){
+  uint8_t background[WINDOW_WIDTH];
+  uint8_t sprites[WINDOW_WIDTH];
+  uint8_t expected[WINDOW_WIDTH];
+  uint8_t out[WINDOW_WIDTH];
+  int types[] = {COMPOSITOR_SSE2, COMPOSITOR_AVX2};
+  CompositeFunc funcs[2];
+  int numOfFuncs = 0;
+  int numOfMismatches = 0;
+  int expectedHit;
+  int hit;
+  int spriteChance;
+  int zeroChance;
+
+  for(int i = 0; i < 2; ++i){
+    if(initCompositor(types[i]) == types[i]){
+      types[numOfFuncs] = types[i];
+      funcs[numOfFuncs++] = compositeScanline;
+    }
+  }
+
+  for(int line = 0; line < numOfLines; ++line){
+    // varies how busy the line is, so that some lines have no sprite 0 hit at all
+    spriteChance = rand() % 8;
+    zeroChance = rand() % 64;
+    for(int i = 0; i < WINDOW_WIDTH; ++i){
+      background[i] = rand() & 0x0f;
+      sprites[i] = 0;
+      if(rand() % 8 < spriteChance){
+        sprites[i] = 0x10 | (rand() & 0x0c) | (1 + rand() % 3) | (rand() & SPRITE_PIXEL_BEHIND);
+        if(rand() % 64 < zeroChance){
+          sprites[i] |= SPRITE_PIXEL_ZERO;
+        }
+      }
+    }
+
+    for(int from = 0; from < WINDOW_WIDTH; ++from){
+      memset(expected, 0xff, WINDOW_WIDTH);
+      expectedHit = compositeScanlineScalar(background, sprites, expected, from);
+      for(int f = 0; f < numOfFuncs; ++f){
+        memset(out, 0xff, WINDOW_WIDTH);
+        hit = funcs[f](background, sprites, out, from);
+        // pixels before from don't have to be written
+        if(hit != expectedHit || memcmp(out + from, expected + from, WINDOW_WIDTH - from) != 0){
+          printf("%s: line %d from %d gives a hit at %d instead of %d", compositorName(types[f]), line, from, hit, expectedHit);
+          for(int i = from; i < WINDOW_WIDTH; ++i){
+            if(out[i] != expected[i]){
+              printf(", pixel %d is %02x instead of %02x", i, out[i], expected[i]);
+              break;
+            }
+          }
+          printf(" \n");
+          numOfMismatches++;
+        }
+      }
+    }
+  }
+
+  initCompositor(COMPOSITOR_AUTO);
+  return numOfMismatches;
+}
@@ -0,0 +1,57 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+
+#pragma once
+#include <stdint.h>
+
+// compositor.h
+//   merges a scanline's background and sprite pixels into the palette index of every pixel.
+//   there are SSE2 and AVX2 versions for x86-64 that do 16 or 32 pixels at a time, picked at runtime
+//   by initCompositor(), and a scalar version for everywhere else that the others are checked against
+
+
+enum CompositorType {COMPOSITOR_AUTO, COMPOSITOR_SCALAR, COMPOSITOR_SSE2, COMPOSITOR_AVX2};
+
+// CompositeFunc
+//   inputs:
+//     background - WINDOW_WIDTH background palette indices (attribute * 4 + colour), already shifted by fine x
+//     sprites - WINDOW_WIDTH entries of the sprite line buffer, see rasterizeSprites()
+//     from - first pixel to merge, the ones before it may or may not be written
+//   output:
+//     out - WINDOW_WIDTH paletteCache indices
+//   return:
+//     x of the first pixel from "from" on where sprite 0 hits an opaque background pixel (x = 255 never hits),
+//     -1 if there isn't one
+typedef int (*CompositeFunc)(const uint8_t*, const uint8_t*, uint8_t*, int);
+
+// set by initCompositor(), the scalar version until then
+extern CompositeFunc compositeScanline;
+
+int initCompositor(int);
+const char* compositorName(int);
+
+int compositeScanlineScalar(const uint8_t*, const uint8_t*, uint8_t*, int);
+
+// checks the SSE2 and AVX2 versions against the scalar one on random lines, returns the number of mismatches
+int checkCompositors(int);
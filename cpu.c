@@ -22,9 +22,8 @@
 
 
 #include "cpu.h"
-
-
-int pageFlag;
+#include "opcodes.h"
+#include "instructions.h"
 
 
 
@@ -33,7 +32,7 @@ void reset(CPU* cpu, Bus* bus){
     cpu->x = 0;
     cpu->y = 0;
     cpu->sp = 0;
-    cpu->pf = 0;
+    setStatus(cpu, 0);
 
 
     //reads reset vector to find starting pc
@@ -48,6 +47,7 @@ void reset(CPU* cpu, Bus* bus){
     
     cpu->cycles = 0;
     cpu->haltFlag = 0;
+    cpu->pageFlag = 0;
 
 }
 
@@ -82,7 +82,7 @@ int nmi(CPU* cpu, Bus* bus){
 
   // pushes the processor flags onto the stack
   //printf("CPU->pf %x \n", cpu->pf);
-  pushStack(cpu, bus, cpu->pf);
+  pushStack(cpu, bus, getStatus(cpu));
 
   // sets the interupt disable flag
   setBit(cpu->pf, 2);
@@ -119,7 +119,7 @@ int irq(CPU* cpu, Bus* bus){
   pushStack(cpu, bus, (uint8_t)(cpu->pc & 0xff00));
 
   // pushes the processor flags onto the stack
-  pushStack(cpu, bus, cpu->pf);
+  pushStack(cpu, bus, getStatus(cpu));
 
   // sets the interupt disable flag
   cpu->pf = setBit(cpu->pf, 2);
@@ -143,1992 +143,597 @@ int irq(CPU* cpu, Bus* bus){
 }
 
 
+// ***** Dispatch *****
+
+// two handlers get generated for every opcode, both with the instruction and addressing mode inlined:
+//   op_0xNN fetches its own operand from the bus, and is what decodeAndExecute() calls
+//   opd_0xNN takes an operand that has already been fetched, and is what the decode cache calls
+#define OPCODE_HANDLER(opcode, instruction, mode, cycles) \
+  static int opd_##opcode(CPU* cpu, Bus* bus, uint16_t operand){ \
+    return cycles + instruction(cpu, bus, mode, operand); \
+  } \
+  static int op_##opcode(CPU* cpu, Bus* bus){ \
+    return cycles + instruction(cpu, bus, mode, fetchOperand(cpu, bus, mode)); \
+  }
+
+OPCODE_LIST(OPCODE_HANDLER)
+
+#define OPCODE_TABLE_ENTRY(opcode, instruction, mode, cycles) [opcode] = op_##opcode,
+#define DECODED_TABLE_ENTRY(opcode, instruction, mode, cycles) [opcode] = opd_##opcode,
+#define OPCODE_CYCLES_ENTRY(opcode, instruction, mode, cycles) [opcode] = cycles,
+#define OPCODE_LENGTH_ENTRY(opcode, instruction, mode, cycles) [opcode] = 1 + OPERAND_LENGTH(mode),
+
+// illegal opcodes are left as NULL
+OpHandler const opTable[256] = {
+  OPCODE_LIST(OPCODE_TABLE_ENTRY)
+};
+
+DecodedHandler const decodedOpTable[256] = {
+  OPCODE_LIST(DECODED_TABLE_ENTRY)
+};
+
+const uint8_t opCycles[256] = {
+  OPCODE_LIST(OPCODE_CYCLES_ENTRY)
+};
+
+const uint8_t opLength[256] = {
+  OPCODE_LIST(OPCODE_LENGTH_ENTRY)
+};
+
+
 // returns how many cycles have been executed
 int decodeAndExecute(CPU* cpu, Bus* bus, uint8_t oppCode){
-  int cyclesCompleted;
+  OpHandler handler;
   //printf("\t Executing oppcode: %x at %x \n", oppCode, cpu->pc);
-  if(cpu->haltFlag == 0){
-  switch(oppCode){
-    case 0x00:
-      cyclesCompleted = brki(cpu, bus);
-      break;
-    case 0x01:
-      cyclesCompleted = ora(cpu, bus, indirectX); 
-      break;
-    case 0x05:
-      cyclesCompleted = ora(cpu, bus, zeroPage);
-      break;
-    case 0x06:
-      cyclesCompleted = asl(cpu, bus, zeroPage);
-      break;
-    case 0x08:
-      cyclesCompleted = php(cpu, bus);
-      break;
-    case 0x09:
-      cyclesCompleted = ora(cpu, bus, immediate);
-      break;
-    case 0x0a:
-      cyclesCompleted = asl(cpu, bus, accumulator);
-      break;
-    case 0x0d:
-      cyclesCompleted = ora(cpu, bus, absolute);
-      break;
-    case 0x0e:
-      cyclesCompleted = asl(cpu, bus, absolute);
-      break;
-    case 0x10:
-      cyclesCompleted = bpl(cpu, bus);
-      break;
-    case 0x11:
-      cyclesCompleted = ora(cpu, bus, indirectY);
-      break;
-    case 0x15:
-      cyclesCompleted = ora(cpu, bus, zeroPageX);
-      break;
-    case 0x16:
-      cyclesCompleted = asl(cpu, bus, zeroPageX);
-      break;
-    case 0x18:
-      cyclesCompleted = clc(cpu);
-      break;
-    case 0x19:
-      cyclesCompleted = ora(cpu, bus, absoluteY);
-      break;
-    case 0x1d:
-      cyclesCompleted = ora(cpu, bus, absoluteX);
-      break;
-    case 0x1e:
-      cyclesCompleted = asl(cpu, bus, absoluteX);
-      break;
-    case 0x20:
-      cyclesCompleted = jsr(cpu, bus);
-      break;
-    case 0x21:
-      cyclesCompleted = and(cpu, bus, indirectX);
-      break;
-    case 0x24:
-      cyclesCompleted = bit(cpu, bus, zeroPage);
-      break;
-    case 0x25:
-      cyclesCompleted = and(cpu, bus, zeroPage);
-      break;
-    case 0x26:
-      cyclesCompleted = rol(cpu, bus, zeroPage);
-      break;
-    case 0x28:
-      cyclesCompleted = plp(cpu, bus);
-      break;
-    case 0x29:
-      cyclesCompleted = and(cpu, bus, immediate);
-      break;
-    case 0x2a:
-      cyclesCompleted = rol(cpu, bus, accumulator);
-      break;
-    case 0x2c:
-      cyclesCompleted = bit(cpu, bus, absolute);
-      break;
-    case 0x2d:
-      cyclesCompleted = and(cpu, bus, absolute);
-      break;
-    case 0x2e:
-      cyclesCompleted = rol(cpu, bus, absolute);
-      break;
-    case 0x30:
-      cyclesCompleted = bmi(cpu, bus);
-      break;
-    case 0x31:
-      cyclesCompleted = and(cpu, bus, indirectY);
-      break;
-    case 0x35:
-      cyclesCompleted = and(cpu, bus, zeroPageX);
-      break;
-    case 0x36:
-      cyclesCompleted = rol(cpu, bus, zeroPageX);
-      break;
-    case 0x38:
-      cyclesCompleted = sec(cpu, bus);
-      break;
-    case 0x39:
-      cyclesCompleted = and(cpu, bus, absoluteY);
-      break;
-    case 0x3d:
-      cyclesCompleted = and(cpu, bus, absoluteX);
-      break;
-    case 0x3e:
-      cyclesCompleted = rol(cpu, bus, absoluteX);
-      break; 
-    case 0x40:
-      cyclesCompleted = rti(cpu, bus);
-      break;
-    case 0x41:
-      cyclesCompleted = eor(cpu, bus, indirectX);
-      break;
-    case 0x45:
-      cyclesCompleted = eor(cpu, bus, zeroPage);
-      break;
-    case 0x46:
-      cyclesCompleted = lsr(cpu, bus, zeroPage);
-      break;
-    case 0x48:
-      cyclesCompleted = pha(cpu, bus);  
-      break;
-    case 0x49:
-      cyclesCompleted = eor(cpu, bus, immediate);
-      break;
-    case 0x4a:
-      cyclesCompleted = lsr(cpu, bus, accumulator);
-      break;
-    case 0x4c:
-      cyclesCompleted = jmp(cpu, bus, absolute);
-      break;
-    case 0x4d:
-      cyclesCompleted = eor(cpu, bus, absolute);
-      break;
-    case 0x4e:
-      cyclesCompleted = lsr(cpu, bus, absolute);
-      break;
-    case 0x50:
-      cyclesCompleted = bvc(cpu, bus);
-      break;
-    case 0x51:
-      cyclesCompleted = eor(cpu, bus, indirectY);
-      break;
-    case 0x55:
-      cyclesCompleted = eor(cpu, bus, zeroPageX);
-      break;
-    case 0x56:
-      cyclesCompleted = lsr(cpu, bus, zeroPageX);
-      break;
-    case 0x58:
-      cyclesCompleted = cli(cpu);
-      break;
-    case 0x59:
-      cyclesCompleted = eor(cpu, bus, absoluteY);
-      break;
-    case 0x5d:
-      cyclesCompleted = eor(cpu, bus, absoluteX);
-      break;
-    case 0x5e:
-      cyclesCompleted = lsr(cpu, bus, absoluteX);
-      break;
-    case 0x60:
-      cyclesCompleted = rts(cpu, bus);
-      break;
-    case 0x61:
-      cyclesCompleted = adc(cpu, bus, indirectX);
-      break;
-    case 0x65:
-      cyclesCompleted = adc(cpu, bus, zeroPage);
-      break;
-    case 0x66:
-      cyclesCompleted = ror(cpu, bus, zeroPage);
-      break;
-    case 0x68:
-      cyclesCompleted = pla(cpu, bus);
-      break;
-    case 0x69:
-      cyclesCompleted = adc(cpu, bus, immediate);
-      break;
-    case 0x6a:
-      cyclesCompleted = ror(cpu, bus, accumulator);
-      break;
-    case 0x6c:
-      cyclesCompleted = jmp(cpu, bus, absoluteIndir);
-      break;
-    case 0x6d:
-      cyclesCompleted = adc(cpu, bus, absolute);
-      break;
-    case 0x6e:
-      cyclesCompleted = ror(cpu, bus, absolute);
-      break;
-    case 0x70:
-      cyclesCompleted = bvs(cpu, bus);
-      break;
-    case 0x71:
-      cyclesCompleted = adc(cpu, bus, indirectY);
-      break;
-    case 0x75:
-      cyclesCompleted = adc(cpu, bus, zeroPageX);
-      break;
-    case 0x76:
-      cyclesCompleted = ror(cpu, bus, zeroPageX);
-      break;
-    case 0x78:
-      cyclesCompleted = sei(cpu, bus);
-      break;
-    case 0x79:
-      cyclesCompleted = adc(cpu, bus, absoluteY);
-      break;
-    case 0x7d:
-      cyclesCompleted = adc(cpu, bus, absoluteX);
-      break;
-    case 0x7e:
-      cyclesCompleted = ror(cpu, bus, absoluteX);
-      break;
-    case 0x81:
-      cyclesCompleted = sta(cpu, bus, indirectX);
-      break;
-    case 0x84:
-      cyclesCompleted = sty(cpu, bus, zeroPage);
-      break;
-    case 0x85:
-      cyclesCompleted = sta(cpu, bus, zeroPage);
-      break;
-    case 0x86:
-      cyclesCompleted = stx(cpu, bus, zeroPage);
-      break;
-    case 0x88:
-      cyclesCompleted = dey(cpu);
-      break;
-    case 0x8a:
-      cyclesCompleted = txa(cpu);
-      break;
-    case 0x8c:
-      cyclesCompleted = sty(cpu, bus, absolute);
-      break;
-    case 0x8d:
-      cyclesCompleted = sta(cpu, bus, absolute);
-      break;
-    case 0x8e:
-      cyclesCompleted = stx(cpu, bus, absolute);
-      break;
-    case 0x90:
-      cyclesCompleted = bcc(cpu, bus);
-      break;
-    case 0x91:
-      cyclesCompleted = sta(cpu, bus, indirectY);
-      break;
-    case 0x94:
-      cyclesCompleted = sty(cpu, bus, zeroPageX);
-      break;
-    case 0x95:
-      cyclesCompleted = sta(cpu, bus, zeroPageX);
-      break;
-    case 0x96:
-      cyclesCompleted = stx(cpu, bus, zeroPageY);
-      break;
-    case 0x98:
-      cyclesCompleted = tya(cpu);
-      break;
-    case 0x99:
-      cyclesCompleted = sta(cpu, bus, absoluteY);
-      break;
-    case 0x9a:
-      cyclesCompleted = txs(cpu);
-      break;
-    case 0x9d:
-      cyclesCompleted = sta(cpu, bus, absoluteX);
-      break;
-    case 0xa0:
-      cyclesCompleted = ldy(cpu, bus, immediate);
-      break;
-    case 0xa1:
-      cyclesCompleted = lda(cpu, bus, indirectX);
-      break;
-    case 0xa2:
-      cyclesCompleted = ldx(cpu, bus, immediate);
-      break;
-    case 0xa4:
-      cyclesCompleted = ldy(cpu, bus, zeroPage);
-      break;
-    case 0xa5:
-      cyclesCompleted = lda(cpu, bus, zeroPage);
-      break;
-    case 0xa6:
-      cyclesCompleted = ldx(cpu, bus, zeroPage);
-      break;
-    case 0xa8:
-      cyclesCompleted = tay(cpu);
-      break;
-    case 0xa9:
-      cyclesCompleted = lda(cpu, bus, immediate);
-      break;
-    case 0xaa:
-      cyclesCompleted = tax(cpu);
-      break;
-    case 0xac:
-      cyclesCompleted = ldy(cpu, bus, absolute);
-      break;
-    case 0xad:
-      cyclesCompleted = lda(cpu, bus, absolute);
-      break;
-    case 0xae:
-      cyclesCompleted = ldx(cpu, bus, absolute);
-      break;
-    case 0xb0:
-      cyclesCompleted = bcs(cpu, bus);
-      break;
-    case 0xb1:
-      cyclesCompleted = lda(cpu, bus, indirectY);
-      break;
-    case 0xb4:
-      cyclesCompleted = ldy(cpu, bus, zeroPageX);
-      break;
-    case 0xb5:
-      cyclesCompleted = lda(cpu, bus, zeroPageX);
-      break;
-    case 0xb6:
-      cyclesCompleted = ldx(cpu, bus, zeroPageY);
-      break;
-    case 0xb8:
-      cyclesCompleted = clv(cpu);
-      break;
-    case 0xb9:
-      cyclesCompleted = lda(cpu, bus, absoluteY);
-      break;
-    case 0xba:
-      cyclesCompleted = tsx(cpu);
-      break;
-    case 0xbc:
-      cyclesCompleted = ldy(cpu, bus, absoluteX);
-      break;
-    case 0xbd:
-      cyclesCompleted = lda(cpu, bus, absoluteX);
-      break;
-    case 0xbe:
-      cyclesCompleted = ldx(cpu, bus, absoluteY);
-      break;
-    case 0xc0:
-      cyclesCompleted = cpy(cpu, bus, immediate);
-      break;
-    case 0xc1:
-      cyclesCompleted = cmp(cpu, bus, indirectX);
-      break;
-    case 0xc4:
-      cyclesCompleted = cpy(cpu, bus, zeroPage);
-      break;
-    case 0xc5:
-      cyclesCompleted = cmp(cpu, bus, zeroPage);
-      break;
-    case 0xc6:
-      cyclesCompleted = dec(cpu, bus, zeroPage);
-      break;
-    case 0xc8:
-      cyclesCompleted = iny(cpu);
-      break;
-    case 0xc9:
-      cyclesCompleted = cmp(cpu, bus, immediate);
-      break;
-    case 0xca:
-      cyclesCompleted = dex(cpu, bus);
-      break;
-    case 0xcc:
-      cyclesCompleted = cpy(cpu, bus, absolute);
-      break;
-    case 0xcd:
-      cyclesCompleted = cmp(cpu, bus, absolute);
-      break;
-    case 0xce:
-      cyclesCompleted = dec(cpu, bus, absolute);
-      break;
-    case 0xd0:
-      cyclesCompleted = bne(cpu, bus);
-      break;
-    case 0xd1:
-      cyclesCompleted = cmp(cpu, bus, indirectY);
-      break;
-    case 0xd5:
-      cyclesCompleted = cmp(cpu, bus, zeroPageX);
-      break;
-    case 0xd6:
-      cyclesCompleted = dec(cpu, bus, zeroPageX);
-      break;
-    case 0xd8:
-      cyclesCompleted = cld(cpu);
-      break;
-    case 0xd9:
-      cyclesCompleted = cmp(cpu, bus, absoluteY);
-      break;
-    case 0xdd:
-      cyclesCompleted = cmp(cpu, bus, absoluteX);
-      break;
-    case 0xde:
-      cyclesCompleted = dec(cpu, bus, absoluteX);
-      break;
-    case 0xe0:
-      cyclesCompleted = cpx(cpu, bus, immediate);
-      break;
-    case 0xe1:
-      cyclesCompleted = sbc(cpu, bus, indirectX);
-      break;
-    case 0xe4:
-      cyclesCompleted = cpx(cpu, bus, zeroPage);
-      break;
-    case 0xe5:
-      cyclesCompleted = sbc(cpu, bus, zeroPage);
-      break;
-    case 0xe6:
-      cyclesCompleted = inc(cpu, bus, zeroPage);
-      break;
-    case 0xe8:
-      cyclesCompleted = inx(cpu);
-      break;
-    case 0xe9:
-      cyclesCompleted = sbc(cpu, bus, immediate);
-      break;
-    case 0xea:
-      cyclesCompleted = nop(cpu);
-      break;
-    case 0xec:
-      cyclesCompleted = cpx(cpu, bus, absolute);
-      break;
-    case 0xed:
-      cyclesCompleted = sbc(cpu, bus, absolute);
-      break;
-    case 0xee:
-      cyclesCompleted = inc(cpu, bus, absolute);
-      break;
-    case 0xf0:
-      cyclesCompleted = beq(cpu, bus);
-      break;
-    case 0xf1:
-      cyclesCompleted = sbc(cpu, bus, indirectY);
-      break;
-    case 0xf5:
-      cyclesCompleted = sbc(cpu, bus, zeroPageX);
-      break;
-    case 0xf6:
-      cyclesCompleted = inc(cpu, bus, zeroPageX);
-      break;
-    case 0xf8:
-      // this function sets the Decimal flag, but has no function since
-      // decimal mode doesn't exist on the nes
-      cyclesCompleted = sed(cpu);
-      break;
-    case 0xf9:
-      cyclesCompleted = sbc(cpu, bus, absoluteY);
-      break;
-    case 0xfd:
-      cyclesCompleted = sbc(cpu, bus, absoluteX);
-      break;
-    case 0xfe:
-      cyclesCompleted = inc(cpu, bus, absoluteX);
-      break;
-    default:
-      printf("illegal instruction: %d - 0x%x at %x \n", oppCode, oppCode, cpu->pc);
-      printf("defaulting to NOP \n");
-      cyclesCompleted = nop(cpu);
-      
-      break;
-  } 
-  }
-  if(cyclesCompleted == -1){
-    printf("Error detected, halting excution \n");
-    printf("Please restart \n");
-    printf("oppcode: %x \n", oppCode);
-    halt(cpu);
+
+  // a halted cpu just burns through the rest of the scanline
+  if(cpu->haltFlag != 0){
     return 114;
   }
 
-  //printf("cycles completed %d for %x \n", cyclesCompleted, oppCode);
-  return cyclesCompleted;
+  handler = opTable[oppCode];
+  if(handler == NULL){
+    printf("illegal instruction: %d - 0x%x at %x \n", oppCode, oppCode, cpu->pc);
+    printf("defaulting to NOP \n");
+    return 2 + nop(cpu, bus, implied, 0);
+  }
 
-}
+  return handler(cpu, bus);
 
-void halt(CPU* cpu){
-  cpu->haltFlag = 1;
+}
 
 
+// decodeOp()
+//   fills in a decode cache entry for the instruction at addr
+static void decodeOp(Bus* bus, DecodedOp* op, uint16_t addr, uint8_t oppCode){
+  op->length = opLength[oppCode];
+  op->cycles = opCycles[oppCode];
+  op->operand = 0;
+  if(op->length > 1){
+    op->operand = readBus(bus, addr + 1);
+  }
+  if(op->length > 2){
+    op->operand |= ((uint16_t)readBus(bus, addr + 2)) << 8;
+  }
+  op->fused = 0;
+  op->handler = decodedOpTable[oppCode];
 }
 
 
-int adc(CPU* cpu, Bus* bus, AddrMode mode){
-  
-
-  // TODO: redo the checkVFlag function;
-  // might have every function have their own implementation of it
-  uint8_t value;
-  uint8_t prevA;
-
-
-
-
-  value = addressModeDecode(cpu, bus, mode);
-  prevA = cpu->a; 
-  cpu->a += value;
-  cpu->a = cpu->a + getBit(cpu->pf, C);
-  //printf("Value from memory: %d \n", value);
-  //printf("cpu->a: %d \n", prevA);
-
-  // NV-BDIZC
-
-  checkVFlag(cpu, value, prevA, ADD);
-  checkCFlag(cpu, value, prevA, ADD);
-  checkZFlag(cpu, cpu->a);
-  //checkVFlag(cpu, cpu->a, value);
-  //if(getBit(value, 7) != getBit(cpu->a, 7)){
-  //if(((int8_t)cpu->a) < ((int8_t)prevA)){
-  //  cpu->pf = setBit(cpu->pf, V);
-  //} else {
-  //  cpu->pf = clearBit(cpu->pf, V);
-  //}
-  
-  /*
-  for(int i = 0; i <= 6; ++i){
-    bit1 = getBit(value, i) >> i; 
-    bit2 = getBit(prevA, i) >> i; 
-    printf("iteration %d \n", i);
-    printf("bit1 %d \n", bit1);
-    printf("bit2 %d \n", bit2);
-    printf("carry %d \n", carry);
-    printf("cpu->pf C flag: %d \n", getBit(prevcpupf, C));
-    printf("cpu->pf %d \n", prevcpupf);
-    if((i == 0) && (getBit(prevcpupf, C) == 1)){
-      carry = 1;
-    } 
-
-    printf("Iteration %d \n", i);
-    printf("\t carry %d \n", carry);
-    printf("\t bit1 %d \n", bit1);
-    printf("\t bit2 %d \n", bit2);
-
-    if(bit1 + bit2 + carry >= 2){
-      carry = 1;
-    } else {
-      carry = 0;
+// ** Fused idioms **
+//
+// short runs of instructions that hot loops are made of get run by a single handler from executeCached(), so the
+// lookup and dispatch is only paid once for the whole run. a fused handler is the opd_0xNN handlers of its instructions
+// one after the other, with the budget checked and cpu->cycles brought up to date in between just like executeCached()
+// does, so it stops on the same instruction and takes the same cycles as running them one by one.
+// only code in ROM gets fused, so that nothing can write over the instructions after the first
+
+// FUSED_PAIRS(), FUSED_TRIPLES()
+//   the runs of instructions that get fused, by opcode
+#define FUSED_PAIRS(X) \
+  X(0xa9, 0x85) /* lda #imm, sta zp */ \
+  X(0xa9, 0x8d) /* lda #imm, sta abs */ \
+  X(0xa5, 0x85) /* lda zp, sta zp */ \
+  X(0xa5, 0x8d) /* lda zp, sta abs */ \
+  X(0xad, 0x85) /* lda abs, sta zp */ \
+  X(0xad, 0x8d) /* lda abs, sta abs */ \
+  X(0xb1, 0x9d) /* lda (zp),y, sta abs,x */ \
+  X(0xb1, 0x91) /* lda (zp),y, sta (zp),y */ \
+  X(0xca, 0xd0) /* dex, bne */ \
+  X(0x88, 0xd0) /* dey, bne */ \
+  X(0xe8, 0xd0) /* inx, bne */ \
+  X(0xc8, 0xd0) /* iny, bne */
+
+#define FUSED_TRIPLES(X) \
+  X(0xc8, 0xc0, 0xd0) /* iny, cpy #imm, bne */ \
+  X(0xe8, 0xe0, 0xd0) /* inx, cpx #imm, bne */
+
+#define FUSED_PAIR_HANDLER(first, second) \
+  static int fused_##first##_##second(CPU* cpu, Bus* bus, DecodedOp* op, int budget){ \
+    int start = cpu->cycles; \
+    int cycles = opd_##first(cpu, bus, op->operand); \
+    if(cycles >= budget){ \
+      return cycles; \
+    } \
+    cpu->cycles = start + cycles; \
+    op += op->length; \
+    return cycles + opd_##second(cpu, bus, op->operand); \
+  }
+
+#define FUSED_TRIPLE_HANDLER(first, second, third) \
+  static int fused_##first##_##second##_##third(CPU* cpu, Bus* bus, DecodedOp* op, int budget){ \
+    int start = cpu->cycles; \
+    int cycles = opd_##first(cpu, bus, op->operand); \
+    if(cycles >= budget){ \
+      return cycles; \
+    } \
+    cpu->cycles = start + cycles; \
+    op += op->length; \
+    cycles += opd_##second(cpu, bus, op->operand); \
+    if(cycles >= budget){ \
+      return cycles; \
+    } \
+    cpu->cycles = start + cycles; \
+    op += op->length; \
+    return cycles + opd_##third(cpu, bus, op->operand); \
+  }
+
+FUSED_PAIRS(FUSED_PAIR_HANDLER)
+FUSED_TRIPLES(FUSED_TRIPLE_HANDLER)
+
+// runs the instructions starting at op, stopping early once budget cycles have been taken. returns the cycles taken
+typedef int (*FusedHandler)(CPU*, Bus*, DecodedOp*, int);
+
+typedef struct _FusedOp {
+  int count;
+  uint8_t opcodes[3];
+  FusedHandler handler;
+} FusedOp;
+
+#define FUSED_PAIR_ENTRY(first, second) {2, {first, second}, fused_##first##_##second},
+#define FUSED_TRIPLE_ENTRY(first, second, third) {3, {first, second, third}, fused_##first##_##second##_##third},
+
+// the triples come first so they get matched before the pairs they start with
+static const FusedOp fusedOps[] = {
+  FUSED_TRIPLES(FUSED_TRIPLE_ENTRY)
+  FUSED_PAIRS(FUSED_PAIR_ENTRY)
+};
+
+
+// fuseOp()
+//   looks for a fused idiom starting with the instruction that has just been decoded at addr, and decodes the rest of
+//   its instructions if there is one. all of them have to be in the same page.
+//   returns the idiom's index in fusedOps plus one, or 0 if there isn't one
+static uint8_t fuseOp(Bus* bus, DecodedOp* page, uint16_t addr){
+  uint8_t* bytes = bus->readPages[addr >> 8];
+  int offset;
+  int matched;
+
+  // only ROM, see above
+  if(bytes == NULL || bus->writePages[addr >> 8] != NULL){
+    return 0;
+  }
+
+  for(int i = 0; i < (int)(sizeof(fusedOps) / sizeof(fusedOps[0])); ++i){
+    offset = addr & 0xff;
+    matched = 1;
+    for(int j = 0; j < fusedOps[i].count && matched == 1; ++j){
+      if(offset + opLength[fusedOps[i].opcodes[j]] > 0x100 || bytes[offset] != fusedOps[i].opcodes[j]){
+        matched = 0;
+      }
+      offset += opLength[fusedOps[i].opcodes[j]];
     }
+    if(matched == 0){
+      continue;
+    }
+
+    offset = (addr & 0xff) + opLength[fusedOps[i].opcodes[0]];
+    for(int j = 1; j < fusedOps[i].count; ++j){
+      if(page[offset].handler == NULL){
+        decodeOp(bus, &page[offset], (addr & 0xff00) | offset, fusedOps[i].opcodes[j]);
+      }
+      offset += opLength[fusedOps[i].opcodes[j]];
+    }
+    return i + 1;
   }
+  return 0;
+}
+
+
+// decodeAndExecuteCached()
+//   same as decodeAndExecute() but goes through the decode cache, so the opcode and operand
+//   of an instruction only get fetched from the bus the first time it's run.
+//   falls back to decodeAndExecute() for anything that can't be cached: code outside of memory that
+//   has a decode cache, instructions that straddle a page and illegal opcodes.
+//   returns how many cycles have been executed
+int decodeAndExecuteCached(CPU* cpu, Bus* bus){
+  DecodedOp* page = bus->decodedPages[cpu->pc >> 8];
+  DecodedOp* op;
+  uint8_t oppCode;
 
-  c6 = carry;
-  m7 = getBit(value, 7) >> 7;
-  n7 = getBit(prevA, 7) >> 7;
-  printf("c6 = %d \n", c6);
-  printf("m7 = %d \n", m7);
-  printf("n7 = %d \n", n7);
-  
-  cf = (!m7 & !n7 & c6) | (m7 & n7 & !c6);
-  cf != 1 ? (cpu->pf = setBit(cpu->pf, V)) : (cpu->pf = clearBit(cpu->pf, V));
-  if(cf == 1){
-    cpu->pf = setBit(cpu->pf, V);
-  } else {
-    cpu->pf = clearBit(cpu->pf, V);
+  if(page == NULL || cpu->haltFlag != 0){
+    return decodeAndExecute(cpu, bus, readBus(bus, cpu->pc));
   }
-  */
-  checkNFlag(cpu, cpu->a);
-  cpu->pc++;
-  switch(mode){
-    case immediate:
-      return 2;
-    case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
-    case absolute:
-      return 4;
-    case absoluteX:
-      return pageFlag == 1 ? 5 : 4;
-    case absoluteY:
-      return pageFlag == 1 ? 5 : 4;
-    case indirectX:
-      return 6;
-    case indirectY:
-      return pageFlag == 1 ? 6 : 5;
-    default:
-      return -1;
-    
+
+  op = &page[cpu->pc & 0xff];
+  if(op->handler == NULL){
+    oppCode = readBus(bus, cpu->pc);
+    if(opTable[oppCode] == NULL || (cpu->pc & 0xff) + opLength[oppCode] > 0x100){
+      return decodeAndExecute(cpu, bus, oppCode);
+    }
+    decodeOp(bus, op, cpu->pc, oppCode);
+    op->fused = fuseOp(bus, page, cpu->pc);
   }
 
+  return op->handler(cpu, bus, op->operand);
 }
 
 
-int and(CPU* cpu, Bus* bus, AddrMode mode){ 
-    uint8_t value;
-    value = addressModeDecode(cpu, bus, mode);
-    cpu->a = cpu->a & value;
+// executeCached()
+//   runs instructions through the decode cache until at least cycleBudget cycles have been taken, the same as calling
+//   decodeAndExecuteCached() in a loop until then, except that fused idioms are run in one go.
+//   cpu->cycles is kept at the cycles taken so far, so the ppu can be caught up part way through (see tickPpu()).
+//   returns how many cycles have been executed
+int executeCached(CPU* cpu, Bus* bus, int cycleBudget){
+  DecodedOp* page;
+  DecodedOp* op;
+  int taken = 0;
+
+  while(taken < cycleBudget){
+    cpu->cycles = taken;
+    page = bus->decodedPages[cpu->pc >> 8];
+    op = page != NULL ? &page[cpu->pc & 0xff] : NULL;
+
+    // anything that isn't already decoded goes through decodeAndExecuteCached()
+    if(op == NULL || op->handler == NULL || cpu->haltFlag != 0){
+      taken += decodeAndExecuteCached(cpu, bus);
+    } else if(op->fused != 0){
+      taken += fusedOps[op->fused - 1].handler(cpu, bus, op, cycleBudget - taken);
+    } else {
+      taken += op->handler(cpu, bus, op->operand);
+    }
+  }
+
+  return taken;
+}
+
 
-    checkNFlag(cpu, cpu->a);
-    checkZFlag(cpu, cpu->a);
-  
-  cpu->pc++;
-  switch(mode){
+// ** Fused idiom check **
+//
+// checkFusedOps() runs random PRG-ROM made up of the fused idioms and a few other instructions through executeCached()
+// and, on a second bus, through decodeAndExecute() one instruction at a time, to make sure fusing them doesn't change
+// anything. operands are picked so that every access lands in RAM and the (zp),y pointers at $f0-$fd stay in RAM too
+
+#define OPCODE_MODE_ENTRY(opcode, instruction, mode, cycles) [opcode] = mode,
+static const uint8_t opModes[256] = {
+  OPCODE_LIST(OPCODE_MODE_ENTRY)
+};
+
+// instructions put in between the idioms, so they start from all sorts of flags and registers
+static const uint8_t unfusedOps[] = {
+  0xa9, 0xa2, 0xa0, 0x18, 0x38, 0x69, 0xc9, 0x29, 0xaa, 0xa8, 0x8a, 0x98,
+  0xe8, 0xc8, 0xca, 0x88, 0xf0, 0x10, 0x48, 0x68, 0xea
+};
+
+// randomOperand()
+//   picks an operand for the instruction at offset o of the rom. branches go back to one of the last few instructions
+static void randomOperand(uint8_t* rom, int o, uint16_t* starts, int numOfStarts){
+  int target;
+
+  switch(opModes[rom[o]]){
     case immediate:
-      return 2;
+      rom[o + 1] = rand();
+      break;
     case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
+      rom[o + 1] = rand() & 0x7f;
+      break;
     case absolute:
-      return 4;
     case absoluteX:
-      return pageFlag == 1 ? 5 : 4;
     case absoluteY:
-      return pageFlag == 1 ? 5 : 4;
-    case indirectX:
-      return 6;
+      rom[o + 1] = rand();
+      rom[o + 2] = 2 + rand() % 5;
+      break;
     case indirectY:
-      return pageFlag == 1 ? 6 : 5;
-    default:
-      return -1;
-    
+      rom[o + 1] = 0xf0 + 2 * (rand() % 7);
+      break;
+    case relative:
+      target = starts[numOfStarts - 1 - rand() % (numOfStarts < 30 ? numOfStarts : 30)];
+      rom[o + 1] = target - (o + 2) < -128 ? 0 : (uint8_t)(target - (o + 2));
+      break;
   }
 }
 
+// randomFusedRom()
+//   fills a 32kb PRG-ROM with random idioms and instructions, ending with a jmp back to $8000
+static void randomFusedRom(uint8_t* rom, uint16_t* starts){
+  const uint8_t* opcodes;
+  int numOfStarts = 0;
+  int count;
+  int length;
+  int o = 0;
 
-int asl(CPU* cpu, Bus* bus, AddrMode mode) {
-    uint8_t value;
-    uint8_t prevValue;
-    value = addressModeDecode(cpu, bus, mode);
-
-    // sets the carry bit to whatever the 7th position of the 
-    // a register was, before the shift left occurs
-    prevValue = value;
-    value = value << 1;
-
-    checkZFlag(cpu, value);
-    checkNFlag(cpu, value);
-    checkCFlag(cpu, value, prevValue, SHIFTL);
-
-    addressModeDecodeWrite(value, cpu, bus, mode);
-    cpu->pc = cpu->pc + 1;
-    switch(mode){
-      case accumulator:
-        return 2;
-      case zeroPage:
-        return 5;
-      case zeroPageX:
-        return 6;
-      case absolute:
-        return 6;
-      case absoluteX:
-        return 7;
-      default:
-        return -1;
+  while(1){
+    if(rand() % 2 == 0){
+      count = rand() % (sizeof(fusedOps) / sizeof(fusedOps[0]));
+      opcodes = fusedOps[count].opcodes;
+      count = fusedOps[count].count;
+    } else {
+      opcodes = &unfusedOps[rand() % sizeof(unfusedOps)];
+      count = 1;
     }
-}
 
+    length = 0;
+    for(int i = 0; i < count; ++i){
+      length += opLength[opcodes[i]];
+    }
+    if(o + length > 0x7ff0){
+      break;
+    }
 
-int bcc(CPU* cpu, Bus* bus){
-  int8_t offset;
-  uint16_t page;
-  offset = addressModeDecode(cpu, bus, relative);
-  page = cpu->pc & 0xff00;
-  if(!getBit(cpu->pf, C)){
-    cpu->pc += offset;
-  }
-  cpu->pc++;
-  if(page == (cpu->pc & 0xff00)){
-    return 3;
-  } else if (page != (cpu->pc & 0xff00)) {
-    return 4;
+    for(int i = 0; i < count; ++i){
+      starts[numOfStarts++] = o;
+      rom[o] = opcodes[i];
+      randomOperand(rom, o, starts, numOfStarts);
+      o += opLength[opcodes[i]];
+    }
   }
 
-  return 2;
-}
+  while(o < 0x7ff7){
+    rom[o++] = 0xea;
+  }
+  rom[0x7ff7] = 0x4c;
+  rom[0x7ff8] = 0x00;
+  rom[0x7ff9] = 0x80;
+  for(o = 0x7ffa; o < 0x8000; o += 2){
+    rom[o] = 0x00;
+    rom[o + 1] = 0x80;
+  }
+}
+
+// checkFusedOps()
+//   inputs:
+//     numOfRoms - number of random roms to try
+//     numOfRuns - number of executeCached() calls made on each rom, each with a random budget
+//   returns the number of runs where the two buses ended up different, printing the first few.
+//   after every run the registers, flags, cycles taken, the instruction stopped on and RAM have to be the same
+int checkFusedOps(int numOfRoms, int numOfRuns){
+  // buses[0] goes through executeCached(), buses[1] through decodeAndExecute()
+  Bus buses[2];
+  CPU* fused = NULL;
+  CPU* unfused = NULL;
+  uint16_t* starts = malloc(0x8000 * sizeof(uint16_t));
+  long numOfFusedOps = 0;
+  int numOfMismatches = 0;
+  int budget;
+  int fusedCycles;
+  int unfusedCycles;
+
+  for(int i = 0; i < 2; ++i){
+    initBus(&buses[i], 2);
+    buses[i].mapper = 0;
+    initMemStruct(&buses[i].memArr[0], 0x0800, Ram, TRUE);
+    initMemStruct(&buses[i].memArr[1], 0x8000, Rom, TRUE);
+    initScheduler(&buses[i].scheduler);
+    updatePageTable(&buses[i]);
+  }
+  enableDecodeCache(&buses[0]);
+  fused = buses[0].cpu;
+  unfused = buses[1].cpu;
+
+  for(int rom = 0; rom < numOfRoms; ++rom){
+    randomFusedRom(buses[0].memArr[1].contents, starts);
+    memcpy(buses[1].memArr[1].contents, buses[0].memArr[1].contents, 0x8000);
+    flushDecodeCache(&buses[0]);
+
+    // the (zp),y pointers point somewhere in $0200-$05ff
+    for(int i = 0; i < 0x800; ++i){
+      buses[0].memArr[0].contents[i] = rand();
+    }
+    for(int i = 0xf1; i < 0xff; i += 2){
+      buses[0].memArr[0].contents[i] = 2 + rand() % 4;
+    }
+    memcpy(buses[1].memArr[0].contents, buses[0].memArr[0].contents, 0x800);
+
+    reset(fused, &buses[0]);
+    fused->a = rand();
+    fused->x = rand();
+    fused->y = rand();
+    fused->sp = rand();
+    setStatus(fused, rand());
+    *unfused = *fused;
+
+    for(int run = 0; run < numOfRuns; ++run){
+      budget = 1 + rand() % 120;
+      fusedCycles = executeCached(fused, &buses[0], budget);
+      fused->cycles = 0;
+
+      unfusedCycles = 0;
+      while(unfusedCycles < budget){
+        unfused->cycles = unfusedCycles;
+        unfusedCycles += decodeAndExecute(unfused, &buses[1], readBus(&buses[1], unfused->pc));
+      }
+      unfused->cycles = 0;
 
+      if(fusedCycles == unfusedCycles && fused->pc == unfused->pc && fused->a == unfused->a && fused->x == unfused->x
+         && fused->y == unfused->y && fused->sp == unfused->sp && getStatus(fused) == getStatus(unfused)
+         && memcmp(buses[0].memArr[0].contents, buses[1].memArr[0].contents, 0x800) == 0){
+        continue;
+      }
 
-int bcs(CPU* cpu, Bus* bus){
-  int8_t offset;
-  uint16_t page = cpu->pc & 0xff00;
+      if(numOfMismatches < 10){
+        printf("rom %d run %d (budget %d): cycles %d - %d, pc %04x - %04x, a %02x - %02x, x %02x - %02x, y %02x - %02x, "
+               "sp %02x - %02x, p %02x - %02x \n", rom, run, budget, fusedCycles, unfusedCycles, fused->pc, unfused->pc,
+               fused->a, unfused->a, fused->x, unfused->x, fused->y, unfused->y, fused->sp, unfused->sp,
+               getStatus(fused), getStatus(unfused));
+      }
+      numOfMismatches++;
 
-  offset = addressModeDecode(cpu, bus, relative);
-  if(getBit(cpu->pf, C)){
-    cpu->pc += offset;
-  }
+      // carries on from the same place
+      *fused = *unfused;
+      memcpy(buses[0].memArr[0].contents, buses[1].memArr[0].contents, 0x800);
+    }
 
-  cpu->pc++;
-  if(page == (cpu->pc & 0xff00)){
-    return 3;
-  } else if (page != (cpu->pc & 0xff00)) {
-    return 4;
+    for(int i = 0; i < 0x8000; ++i){
+      if(buses[0].memArr[1].decoded[i].handler != NULL && buses[0].memArr[1].decoded[i].fused != 0){
+        numOfFusedOps++;
+      }
+    }
   }
 
-  return 2;
-}
+  printf("%d roms, %ld fused idioms decoded \n", numOfRoms, numOfFusedOps);
+  free(starts);
+  return numOfMismatches;
+}
+
+// skipIdleLoop()
+//   called when a branch or jmp at branchPc has just gone back to target. games often wait for nmi or vblank in a loop
+//   that only jumps to itself, or polls RAM or the vblank flag in $2002 with a single instruction and branches back to it.
+//   nothing such a loop looks at can change before the next event: RAM is only written by the cpu, the vblank flag is
+//   only set and cleared by the vblank events, and interrupts are only taken on events. every trip around it does
+//   exactly the same thing, so as many trips as would start before the end of the run are skipped.
+//   a poll loop is only skipped once the branch has been taken right after the poll (lastPc). the other bits of $2002
+//   can change part way through, but whatever the skipped reads set is set again by the reads made before the event.
+//   returns the cycles skipped, a whole number of trips that leaves the cpu back at target
+static int skipIdleLoop(Bus* bus, uint16_t target, uint16_t branchPc, int lastPc, int branchCycles, int cyclesLeft){
+  uint8_t oppCode;
+  uint8_t branch;
+  uint16_t address;
+  int loopCycles = branchCycles;
+
+  if(target != branchPc){
+    if(lastPc != target){
+      return 0;
+    }
+    oppCode = readBus(bus, target);
+    if(target + opLength[oppCode] != branchPc){
+      return 0;
+    }
 
-int beq(CPU* cpu, Bus* bus){
-  int8_t offset;
-  uint16_t page = cpu->pc & 0xff00;
+    address = readBus(bus, target + 1);
+    if(opLength[oppCode] == 3){
+      address |= ((uint16_t)readBus(bus, target + 2)) << 8;
+    }
 
-  offset = addressModeDecode(cpu, bus, relative);
-  if(getBit(cpu->pf, Z) != 0){
-    cpu->pc += offset;
-  }
-  cpu->pc++;
-  if(page == (cpu->pc & 0xff00)){
-    return 3;
-  } else if (page != (cpu->pc & 0xff00)) {
-    return 4;
-  }
+    switch(oppCode){
+      // lda, ldx, ldy and bit, zero page and absolute: N comes straight from the value read
+      case 0xa5: case 0xad:
+      case 0xa6: case 0xae:
+      case 0xa4: case 0xac:
+      case 0x24: case 0x2c:
+        branch = readBus(bus, branchPc);
+        if(address >= 0x2000 && address <= 0x3fff && (address & 0x7) == 2 && (branch == 0x10 || branch == 0x30)){
+          break;
+        }
+        if(address >= 0x2000){
+          return 0;
+        }
+        break;
+
+      // cmp, cpx and cpy, zero page and absolute
+      case 0xc5: case 0xcd:
+      case 0xe4: case 0xec:
+      case 0xc4: case 0xcc:
+        if(address >= 0x2000){
+          return 0;
+        }
+        break;
 
-  return 2;
+      default:
+        return 0;
+    }
+    loopCycles += opCycles[oppCode];
+  }
 
+  if(cyclesLeft <= 0){
+    return 0;
+  }
+  return ((cyclesLeft - 1) / loopCycles) * loopCycles;
 }
 
 
-int bit(CPU* cpu, Bus* bus, AddrMode mode){
-
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  uint8_t prevValue = value;
-    value = value & cpu->a;
-    checkNFlag(cpu, prevValue);
-    checkZFlag(cpu, value);
+// execute()'s switch has a case for every opcode, with the instruction and addressing mode inlined.
+// a branch or jmp that goes backwards might have gone back to an idle loop (see skipIdleLoop())
+#define EXECUTE_CASE(opcode, instruction, mode, cycles) \
+      case opcode: \
+        ran = cycles + instruction(&regs, bus, mode, fetchOperand(&regs, bus, mode)); \
+        taken += ran; \
+        if((mode == relative || opcode == 0x4c) && regs.pc <= pc){ \
+          taken += skipIdleLoop(bus, regs.pc, pc, lastPc, ran, cycleBudget - taken); \
+        } \
+        break;
 
 
-  // we are checking for the V flag here since the BIT instruction affects
-  // the flag differently from other instructions, and thus our checkVFlag() function
-  // is not suitable to use.
-  //
-  if(getBit(prevValue ,6) != 0){
-    cpu->pf = setBit(cpu->pf, V);
-  } else {
-    cpu->pf = clearBit(cpu->pf, V);
-  }
-  cpu->pc++;
-  switch(mode){
-    case absolute:
-      return 3;
-    case zeroPage:
-      return 4;
-    default:
-      return -1;
-  }
-  
-}
+// execute()
+//   runs instructions until at least cycleBudget cycles have been taken and returns how many were.
+//   the registers and flags are copied into regs for the whole run so that they can be kept in host registers,
+//   and are only written back to cpu when it ends and around illegal opcodes, which go through decodeAndExecute().
+//   nothing on the bus looks at the registers and interrupts are only taken in between runs (see runScanline()),
+//   so the only thing kept up to date in cpu is cycles, for tickPpu(). idle loops are skipped through (see skipIdleLoop())
+int execute(CPU* cpu, Bus* bus, int cycleBudget){
+  CPU regs = *cpu;
+  int taken = 0;
+  int ran;
+  int pc = -1;
+  int lastPc;
+  uint8_t oppCode;
 
-int bmi(CPU* cpu, Bus* bus){
-  int8_t offset;
-  int cycles = 2;
+  while(taken < cycleBudget){
+    // a halted cpu just burns through the rest of the run
+    if(regs.haltFlag != 0){
+      taken = cycleBudget;
+      break;
+    }
 
-  uint16_t page = cpu->pc & 0xff00;
-  offset = addressModeDecode(cpu, bus, relative);
-  if(getBit(cpu->pf, N) != 0){
-    cpu->pc += offset;
-    cycles += 1;
-  }
-  if(page == (cpu->pc & 0xff00)){
-    cycles += 2;
+    cpu->cycles = taken;
+    lastPc = pc;
+    pc = regs.pc;
+    oppCode = readBus(bus, regs.pc);
+    switch(oppCode){
+      OPCODE_LIST(EXECUTE_CASE)
+      default:
+        *cpu = regs;
+        cpu->cycles = taken;
+        taken += decodeAndExecute(cpu, bus, oppCode);
+        regs = *cpu;
+        break;
+    }
   }
-  cpu->pc++;
-  return cycles;
 
+  regs.cycles = cpu->cycles;
+  *cpu = regs;
+  return taken;
 }
 
-int bne(CPU* cpu, Bus* bus){
-  int8_t offset;
-  uint16_t page = cpu->pc & 0xff00;
-  int cycles = 2;
 
-  offset = addressModeDecode(cpu, bus, relative);
-
-  if(getBit(cpu->pf, Z) == 0){
-    cpu->pc += offset;
-    cycles = 3;
-  }
-  if(page == (cpu->pc & 0xff00)){
-    cycles += 2;
-  }
-  cpu->pc++;
-  return cycles;
+void halt(CPU* cpu){
+  cpu->haltFlag = 1;
 
 
 }
 
-int bpl(CPU* cpu, Bus* bus){
-  int8_t offset;
-  uint16_t page = cpu->pc & 0xff00;
-
-  int cycles = 2;
-  offset = (int8_t)addressModeDecode(cpu, bus, relative);
-  if(!getBit(cpu->pf, N)){
-    cpu->pc += offset;
-  }
-
-  if(getBit(cpu->pf, N) != 0){
-    cycles += 1;
-  }
-  if(page == (cpu->pc & 0xff00)){
-    cycles += 2;
-  }
-  cpu->pc++;
-  return cycles;
-
-}
-
 
 int brki(CPU* cpu, Bus* bus){
-
-  // break flag set to be prepared when pushed onto the stack
-  cpu->pf = setBit(cpu->pf, 4);
-
- 
-  uint16_t temp;
-
-  // push the msb and lsb of the program counter+2 onto the stack
-  temp = cpu->pc + 2;
-  pushStack(cpu, bus, (uint8_t)((temp & 0xff00) >> 8));
-  pushStack(cpu, bus, (uint8_t)(temp & 0x00ff));
-  //printf("Push Stack: %x \n", (uint8_t)((temp & 0xff00) >> 8));
-
-  // pushes the processor flags onto the stack
-  pushStack(cpu, bus, cpu->pf);
-
-  // sets the interupt disable flag
-  cpu->pf = setBit(cpu->pf, 2);
-
-
-  // break flag is now cleared because it only exists within the stack
-  cpu->pf = clearBit(cpu->pf, 4);
-
-
-  cpu->pc = readBus(bus, 0xfffe);
-  temp = (uint16_t)readBus(bus, 0xffff);
-  temp = temp << 8;
-  cpu->pc = cpu->pc | temp;
-  //printf("Setting pc to %d \n", cpu->pc);
-
+  brk(cpu, bus, implied, 0);
   return 7;
-
-
- 
-
-
-}
-
-int bvc(CPU* cpu, Bus* bus){
-  int8_t offset;
-  uint16_t page = cpu->pc & 0xff00;
-  int cycles = 2;
-  offset = addressModeDecode(cpu, bus, relative);
-  if(!getBit(cpu->pf, V)){
-    cpu->pc += offset;
-  }
-
-  if(!getBit(cpu->pf, V)){
-    cycles += 1;
-  }
-  if(page == (cpu->pc & 0xff00)){
-    cycles += 2;
-  }
-  cpu->pc++;
-  return cycles;
-}
-
-int bvs(CPU* cpu, Bus* bus){
-  int8_t offset;
-  uint16_t page = cpu->pc & 0xff00;
-  int cycles = 2;
-  offset = addressModeDecode(cpu, bus, relative);
-  //uint8_t cpupclowbyte = cpu->pc & 0xff;
-
-  if(getBit(cpu->pf, V)){
-    cpu->pc += offset;
-  }
-  //cpu->pc = (cpu->pc & 0xff00) | cpupclowbyte;
-  //
-  if(getBit(cpu->pf, V)){
-    cycles += 1;
-  }
-  if(page == (cpu->pc & 0xff00)){
-    cycles += 2;
-  }
-  cpu->pc++;
-  return cycles;
-}
-
-int clc(CPU* cpu){
-  cpu->pf = clearBit(cpu->pf, C);
-  cpu->pc++;
-  return 2;
-}
-
-
-int plp(CPU* cpu, Bus* bus){
-  cpu->pf = popStack(cpu, bus);
-  cpu->pf = setBit(cpu->pf, 5);
-  cpu->pf = clearBit(cpu->pf, 4);
-  cpu->pc++;
-  return 4;
-}
-
-
-int cld(CPU* cpu){
-  cpu->pf = clearBit(cpu->pf, D);
-  cpu->pc++;
-  return 2;
-}
-
-
-int cli(CPU* cpu){
-  cpu->pf = clearBit(cpu->pf, I);
-  cpu->pc++;
-  return 2;
-}
-
-int clv(CPU* cpu){
-  cpu->pf = clearBit(cpu->pf, V);
-  cpu->pc++;
-  return 2;
-}
-
-int cmp(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value;
-  value = addressModeDecode(cpu, bus, mode);
-
-  if(value <= cpu->a){
-    cpu->pf = setBit(cpu->pf, C);
-  } else {
-    cpu->pf = clearBit(cpu->pf, C);
-  }
-  value = cpu->a - value;
-
-  checkZFlag(cpu, value);
-  checkNFlag(cpu, value);
-
-  cpu->pc++;
-  
-  switch(mode){
-    case immediate:
-      return 2;
-    case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
-    case absolute:
-      return 4;
-    case absoluteX:
-      return pageFlag == 1 ? 5 : 4;
-    case absoluteY:
-      return pageFlag == 1 ? 5 : 4;
-    case indirectX:
-      return 6;
-    case indirectY:
-      return pageFlag == 1 ? 6 : 5;
-    default:
-      return -1;
-  }
-
-}
-
-int cpx(CPU* cpu, Bus* bus, AddrMode mode){
-
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  //checkCFlag(cpu, cpu->x, value, SUB);
-  if(value <= cpu->x){
-    cpu->pf = setBit(cpu->pf, C);
-  } else {
-    cpu->pf = clearBit(cpu->pf, C);
-  }
-  checkNFlag(cpu, cpu->x - value);
-  checkZFlag(cpu, cpu->x - value);
-  cpu->pc++;
-  switch(mode){
-    case immediate:
-      return 2;
-    case zeroPage:
-      return 3;
-    case absolute:
-      return 4;
-    default:
-      return -1;
-  }
-  
-}
-
-int cpy(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  //checkCFlag(cpu, cpu->y, value, SUB);
-  if(cpu->y >= value){
-    cpu->pf = setBit(cpu->pf, C);
-  } else {
-    cpu->pf = clearBit(cpu->pf, C);
-  }
-  checkNFlag(cpu, cpu->y - value);
-  checkZFlag(cpu, cpu->y - value);
-  cpu->pc++;
-  switch(mode){
-    case immediate:
-      return 2;
-    case zeroPage:
-      return 3;
-    case absolute:
-      return 4;
-    default:
-      return -1;
-  }
-  
-
-}
-
-int dec(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  value = value - 1;
-  checkNFlag(cpu, value);
-  checkZFlag(cpu, value);
-  addressModeDecodeWrite(value, cpu, bus, mode);
-  cpu->pc++;
-  switch(mode){
-    case zeroPage:
-      return 5;
-    case zeroPageX:
-      return 6;
-    case absolute:
-      return 6;
-    case absoluteX:
-      return 7;
-    default:
-      return -1;
-  }
-
-}
-
-
-
-int dex(CPU* cpu, Bus* bus){
-  cpu->x--;
-  checkNFlag(cpu, cpu->x);
-  checkZFlag(cpu, cpu->x);
-  cpu->pc++;
-  return 2;
-}
-
-int dey(CPU* cpu){
-  cpu->y--;
-  checkNFlag(cpu, cpu->y);
-  checkZFlag(cpu, cpu->y);
-  cpu->pc++;
-  return 2;
-}
-
-int eor(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  cpu->a = cpu->a ^ value;
-  checkZFlag(cpu, cpu->a);
-  checkNFlag(cpu, cpu->a);
-  cpu->pc++;
-  switch(mode){
-
-    case immediate:
-     return 2;
-    case zeroPage:
-     return 3;
-    case zeroPageX:
-     return 4;
-    case absolute:
-     return 4;
-    case absoluteX:
-     return pageFlag == 1 ? 5 : 4;
-    case absoluteY:
-     return pageFlag == 1 ? 5 : 4;
-    case indirectX:
-     return 6;
-    case indirectY:
-     return pageFlag == 1 ? 6 : 5;
-    default:
-      return -1;
-
-  }
-
-}
-
-int inc(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  value++;
-  checkNFlag(cpu, value);
-  checkZFlag(cpu, value);
-  addressModeDecodeWrite(value, cpu, bus, mode);
-  cpu->pc++;
-  switch(mode){
-    case zeroPage:
-      return 5;
-    case zeroPageX:
-      return 6;
-    case absolute:
-      return 6;
-    case absoluteX:
-      return 7;
-    default:
-      return -1;
-  }
-
-}
-
-
-int inx(CPU* cpu){
-  cpu->x++;
-  checkZFlag(cpu, cpu->x);
-  checkNFlag(cpu, cpu->x);
-  cpu->pc++;
-  return 2;
-
-
-}
-
-int iny(CPU* cpu){
-  cpu->y++;
-  checkZFlag(cpu, cpu->y);
-  checkNFlag(cpu, cpu->y);
-  cpu->pc++;
-  return 2;
-
-}
-
-// jmp handles it's own address mode decoding, since addressModeDecode is unable
-// return a 16 bit value
-// also Absolute Indirect is only used in JMP.
-int jmp(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t lowByte;
-  uint16_t highByte, addr;
-
-  lowByte = readBus(bus, ++cpu->pc);
-  highByte = readBus(bus, ++cpu->pc);
-  //printf("lowByte %d \n", lowByte);
-  //printf("highByte %d \n", highByte);
-
-  addr = (highByte << 8) | (uint16_t)lowByte;
-  if(mode == absolute){
-    //cpu->pc = ((uint16_t)readBus(bus, addr + 1)) << 8 | readBus(bus, addr);
-    cpu->pc = addr;
-  } else if(mode == absoluteIndir){
-    cpu->pc = readBus(bus, addr) | (readBus(bus, (lowByte = lowByte + 1) | (highByte << 8)) << 8);
-    
-  }
-  if(mode == absolute){
-    return 3;
-  } else {
-    return 5;
-  }
-  //printf("addr: %x \n", addr);
-  //printf("cpu->pc: %x \n", cpu->pc);
-}
-
-
-// jsr - jump to subroutine
-// jumps to new address while pushing the contents of the program counter 
-// onto the stack.
-int jsr(CPU* cpu, Bus* bus){
-  uint8_t lowByte;
-  uint8_t highByte;
-  lowByte = readBus(bus, ++cpu->pc);
-  highByte = readBus(bus, ++cpu->pc);
-
-
-  //printf("Current pc: %x \n", cpu->pc);
-  //printf("Pushing %x \n", (uint8_t)cpu->pc);
-  //printf("Pushing %x \n", (uint8_t)(cpu->pc >> 8));
-  pushStack(cpu, bus, (uint8_t)(cpu->pc >> 8));
-  pushStack(cpu, bus, (uint8_t)(cpu->pc & 0xff));
-  cpu->pc = ((uint16_t)highByte) << 8;
-  cpu->pc = cpu->pc | (uint16_t)lowByte;
-  return 6;
-  //printf("cpu->pc: %x \n", cpu->pc);
-}
-
-
-int lda(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode); 
-  //printf("lda value: %x \n", value);
-  cpu->a = value;
-  checkZFlag(cpu, cpu->a);
-  checkNFlag(cpu, cpu->a);
-  cpu->pc++;
-  switch(mode){
-    case immediate:
-      return 2;
-    case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
-    case absolute:
-      return 4;
-    case absoluteX:
-      return pageFlag == 1 ? 5 : 4;
-    case absoluteY:
-      return pageFlag == 1 ? 5 : 4;
-    case indirectX:
-      return 6;
-    case indirectY:
-      return pageFlag == 1 ? 6 : 5;
-    default:
-      return -1;
-  }
-}
-
-int ldx(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode); 
-  cpu->x = value;
-  checkZFlag(cpu, cpu->x);
-  checkNFlag(cpu, cpu->x);
-  cpu->pc++;
-  switch(mode){
-
-    case immediate:
-      return 2;
-    case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
-    case zeroPageY:
-      return 4;
-    case absolute:
-      return 4;
-    case absoluteY:
-      return pageFlag == 1 ? 5 : 4;
-    default:
-      return -1;
-
-  }
-}
-
-
-int ldy(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode); 
-  cpu->y = value;
-  checkZFlag(cpu, cpu->y);
-  checkNFlag(cpu, cpu->y);
-  cpu->pc++;
-  
-   switch(mode){
-
-    case immediate:
-      return 2;
-    case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
-    case absolute:
-      return 4;
-    case absoluteX:
-      return pageFlag == 1 ? 5 : 4;
-    default:
-      return -1;
-
-  } 
-  
-}
-
-int lsr(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  uint8_t prevValue = value;
-  value = value >> 1;
-  checkNFlag(cpu, value);
-  checkZFlag(cpu, value);
-  checkCFlag(cpu, value, prevValue, ROTATER);
-  addressModeDecodeWrite(value, cpu, bus, mode);
-  cpu->pc++;
-  switch(mode){
-
-    case accumulator:
-      return 2;
-    case zeroPage:
-      return 5;
-    case zeroPageX:
-      return 6;
-    case absolute:
-      return 6;
-    case absoluteX:
-      return 7;
-    default:
-      return -1;
-
-  }
-}
-
-int nop(CPU* cpu){
-  cpu->pc++;
-  return 2;
-}
-
-int ora(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  //printf("Doing ORA operation on %x \n", value);
-  cpu->a = cpu->a | value;
-  checkNFlag(cpu, cpu->a);
-  checkZFlag(cpu, cpu->a);
-  cpu->pc++;
-  switch(mode){
-    case immediate:
-      return 2;
-    case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
-    case zeroPageY:
-      return 4;
-    case absolute:
-      return 4;
-    case absoluteX:
-      return pageFlag == 1 ? 5 : 4;
-    case absoluteY:
-      return pageFlag == 1 ? 5 : 4;
-    case indirectX:
-      return 6;
-    case indirectY:
-      return pageFlag == 1 ? 6 : 5;
-    default:
-      return -1;
-  }
-}
-
-int pha(CPU* cpu, Bus* bus){
-  pushStack(cpu, bus, cpu->a);
-  cpu->pc++;
-  return 3;
-}
-
-
-int php(CPU* cpu, Bus* bus){
-  uint8_t val;
-  val = setBit(cpu->pf, B);
-  pushStack(cpu, bus, val);  
-  cpu->pc++;
-  return 3;
-}
-
-
-int pla(CPU* cpu, Bus* bus){
-  cpu->a = popStack(cpu, bus);
-  //printf("cpu->pf in pla: %d \n", cpu->pf);
-  checkNFlag(cpu, cpu->a);
-  checkZFlag(cpu, cpu->a);
-  cpu->pc++;
-  return 4;
-}
-
-
-int rol(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  uint8_t prevValue = value;
-
-  // sets the C Flag as bit 7 of the input 
-
-  
-  value = value << 1;
-
-  // sets bit 0 as the input carry (after the operation as taken place)
-  if(getBit(cpu->pf, 0) == 0){
-    value = clearBit(value, 0); 
-  } else {
-    value = setBit(value, 0);
-  }
-
-  checkCFlag(cpu, value, prevValue, ROTATEL);  
-  checkZFlag(cpu, value);
-  checkNFlag(cpu, value);
-  addressModeDecodeWrite(value, cpu, bus, mode);
-  cpu->pc++;
-  switch(mode){
-    case accumulator:
-      return 2;
-    case zeroPage:
-      return 5;
-    case zeroPageX:
-      return 6;
-    case absolute:
-      return 6;
-    case absoluteX:
-      return 7;
-    default:
-      return -1;
-
-  }
-
-}
-
-
-int ror(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode); 
-  uint8_t prevValue = value;
-
-
-  //printf("value before ror: %d \n", value);
-  value = value >> 1;
-  //printf("value after ror: %d \n", value);
-
-  // sets bit 0 to the carry flag of the previous operation
-  if(getBit(cpu->pf, C) == 0){
-    value = clearBit(value, 7);
-  } else {
-    value = setBit(value, 7);
-  }
-
-  checkCFlag(cpu, value, prevValue, ROTATER);  
-  checkZFlag(cpu, value);
-  checkNFlag(cpu, value);
-  addressModeDecodeWrite(value, cpu, bus, mode);
-  cpu->pc++;
-  switch(mode){
-    case accumulator:
-      return 2;
-    case zeroPage:
-      return 5;
-    case zeroPageX:
-      return 6;
-    case absolute:
-      return 6;
-    case absoluteX:
-      return 7;
-    default:
-      return -1;
-
-  }
-
-}
-
-int rti(CPU* cpu, Bus* bus){
-
-
-
-  cpu->pf = popStack(cpu, bus);
-  cpu->pf = setBit(cpu->pf, U);
-  cpu->pc = (uint16_t)popStack(cpu, bus);
-  cpu->pc = (cpu->pc | (((uint16_t)popStack(cpu, bus)) << 8));
-  //printf("cpu->pc after popping in rti: %x \n", cpu->pc);
-
-
-  // clears the brk flag
-  // 
-  cpu->pf = clearBit(cpu->pf, 4);
-
-  return 6; 
-
-
-
-}
-
-int rts(CPU* cpu, Bus* bus){
-  cpu->pc = (uint16_t) popStack(cpu, bus);
-  cpu->pc += (uint16_t) popStack(cpu, bus) << 8;
-  cpu->pc++;
-  return 6;
-}
-
-int sec(CPU* cpu, Bus* bus){
-  cpu->pf = setBit(cpu->pf, C);
-  cpu->pc++;
-  return 2;
-}
-
-int sed(CPU* cpu){
-  cpu->pf = setBit(cpu->pf, D);
-  cpu->pc++;
-  return 2;
-
-}
-int sei(CPU* cpu, Bus* bus){
-  cpu->pf = setBit(cpu->pf, I);
-  cpu->pc++;
-  return 2;
-}
-
-
-
-int sbc(CPU* cpu, Bus* bus, AddrMode mode){
-  uint8_t value = addressModeDecode(cpu, bus, mode);
-  uint8_t prevA = cpu->a;
-  uint16_t temp = 0;
-
-  // getting one's complement
-  value = ~value;
-  cpu->a += value;
-  cpu->a += getBit(cpu->pf, C);
-  temp = value + prevA + getBit(cpu->pf, C);
-  
-  //printf("sbc: value - %d ; prevA - %d \n", value, prevA);
-
-  checkVFlag(cpu, value, prevA, SUB);
-  checkZFlag(cpu, cpu->a);
-  checkNFlag(cpu, cpu->a);
-
-  
-  //printf("temp: %d \n", temp);
-  if(temp >= 256){
-    //puts("setting C flag \n");
-    cpu->pf = setBit(cpu->pf, C);
-  } else {
-    //puts("clearing C flag \n");
-    cpu->pf = clearBit(cpu->pf, C);
-  }
-
-  cpu->pc++;
-  switch(mode){
-
-    case immediate:
-      return 2;
-    case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
-    case absolute:
-      return 4;
-    case absoluteX:
-      return pageFlag == 1 ? 5 : 4;
-    case absoluteY:
-      return pageFlag == 1 ? 5 : 4;
-    case indirectX:
-      return 6;
-    case indirectY:
-      return pageFlag == 1 ? 6 : 5;
-    default:
-      return -1;
-
-  }
-
-
-}
-
-
-
-// STA - store accumulator in memory
-int sta(CPU* cpu, Bus* bus, AddrMode mode){
-  switch(mode){
-    case absolute:
-    case absoluteY:
-    case absoluteX:
-      cpu->pc++;
-      cpu->pc++;
-      break;
-    case zeroPage:
-    case indirectX:
-    case indirectY:
-    case zeroPageX:
-      cpu->pc++;
-      break;
-    default:
-      cpu->pc++;
-      break;
-  }
-  // if(mode == absolute || mode == absoluteY){
-  //   cpu->pc++;
-  //   cpu->pc++;
-  // } else if(mode == zeroPage || mode == indirectX || mode == indirectY || mode == zeroPageX){
-  //   cpu->pc++;
-  // }
-  addressModeDecodeWrite(cpu->a, cpu, bus, mode);
-  cpu->pc++;
-  switch(mode){
-    case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
-    case absolute:
-      return 4;
-    case absoluteX:
-      return 5;
-    case absoluteY:
-      return 5;
-    case indirectX:
-      return 6;
-    case indirectY:
-      return 6;
-    default:
-      return -1;
-  }
-  
-}
-
-int stx(CPU* cpu, Bus* bus, AddrMode mode){
-
-
-  if(mode == absolute){
-    cpu->pc++;
-    cpu->pc++;
-  } else if ((mode == zeroPage) | (mode == zeroPageY)){
-    cpu->pc++;
-  }
-
-  addressModeDecodeWrite(cpu->x, cpu, bus, mode);
-  cpu->pc++;
-  switch(mode){
-    case zeroPage:
-      return 3;
-    case zeroPageY:
-      return 4;
-    case absolute:
-      return 4;
-    default:
-      return -1;
-
-  }
-}
-
-
-int sty(CPU* cpu, Bus* bus, AddrMode mode){
-  if(mode == absolute){
-    cpu->pc++;
-    cpu->pc++;
-  } else if (mode == zeroPage || mode == zeroPageX){
-    cpu->pc++;
-  }
-  addressModeDecodeWrite(cpu->y, cpu, bus, mode);
-  cpu->pc++;
-  switch(mode){
-    case zeroPage:
-      return 3;
-    case zeroPageX:
-      return 4;
-    case absolute:
-      return 4;
-    default:
-      return -1;
-
-  }
-
-}
-
-int tax(CPU* cpu){
-  cpu->x = cpu->a;
-  checkNFlag(cpu, cpu->x);
-  checkZFlag(cpu, cpu->x);
-  cpu->pc++;
-  return 2;
-}
-
-
-int tay(CPU* cpu){
-  cpu->y = cpu->a;
-  checkNFlag(cpu, cpu->y);
-  checkZFlag(cpu, cpu->y);
-  cpu->pc++;
-  return 2;
-}
-
-
-int tsx(CPU* cpu){
-  cpu->x = cpu->sp;
-  checkNFlag(cpu, cpu->x);
-  checkZFlag(cpu, cpu->x);
-  cpu->pc++;
-  return 2;
-}
-
-int txa(CPU* cpu){
-  cpu->a = cpu->x;
-  checkNFlag(cpu, cpu->a);
-  checkZFlag(cpu, cpu->a);
-  cpu->pc++;
-  return 2;
-}
-
-int txs(CPU* cpu){
-  cpu->sp = cpu->x;
-  cpu->pc++;
-  return 2;
-}
-
-int tya(CPU* cpu){
-  cpu->a = cpu->y;
-  checkNFlag(cpu, cpu->a);
-  checkZFlag(cpu, cpu->a);
-  cpu->pc++;
-  return 2;
-}
-
-
-
-
-void addressModeDecodeWrite(uint8_t value, CPU* cpu, Bus* bus, AddrMode mode){
-
-
-  // TODO: fix cpu->pc incrementing; some addressing modes increment the pc differently and thus
-  // are incompatible with instructions that do not do an addressModeDecode first ex: stx, sty
-  // 
-  uint16_t lowByte, highByte;
-  uint8_t zeroPageAddr;
-
-  switch(mode){
-    case absolute:
-      lowByte = readBus(bus, cpu->pc - 1);
-      highByte = readBus(bus, cpu->pc);
-      writeBus(bus, (highByte << 8) + lowByte, value);
-      return;
-    case absoluteX:
-      lowByte = readBus(bus, cpu->pc - 1);
-      highByte = readBus(bus, cpu->pc);
-      writeBus(bus, (highByte << 8) + lowByte + cpu->x, value);
-      return;
-    case absoluteY:
-      lowByte = readBus(bus, cpu->pc - 1);
-      highByte = readBus(bus, cpu->pc);
-      writeBus(bus, (highByte << 8) + lowByte + cpu->y, value);
-      return;
-    case accumulator:
-      cpu->a = value;
-      return;
-    case zeroPage:
-      lowByte = readBus(bus, cpu->pc);
-      writeBus(bus, lowByte & 0xff, value);
-      return;
-    case zeroPageX:
-      // bitwise AND with 0xff so as to only get the lower 8 bits
-      zeroPageAddr = readBus(bus, cpu->pc);
-      zeroPageAddr = zeroPageAddr + cpu->x;
-      writeBus(bus, zeroPageAddr, value);
-      return;
-    case zeroPageY:
-      zeroPageAddr = readBus(bus, cpu->pc);
-      writeBus(bus, zeroPageAddr = zeroPageAddr + cpu->y, value);
-      return;
-    case indirectX:
-      // inner readBus function gets the bytes from the second byte of the instruction
-      //
-      // outer readBus function gets the low and high bytes, of which are in the
-      // zero page and who's contents will yield our effective address
-      lowByte = readBus(bus, (readBus(bus, cpu->pc) + cpu->x) & 0xff);
-      highByte = readBus(bus, (readBus(bus, cpu->pc) + cpu->x + 1) & 0xff);
-      writeBus(bus, (highByte << 8) + lowByte, value);
-      return;
-    case indirectY:
-      zeroPageAddr = readBus(bus, cpu->pc);
-      lowByte = readBus(bus, zeroPageAddr);
-      highByte = readBus(bus, ++zeroPageAddr);
-      writeBus(bus, (highByte << 8) + (lowByte = lowByte + cpu->y), value);
-      return;
-    default:
-      return;
-
-  }
-  
-
-
-
-}
-
-
-uint8_t addressModeDecode(CPU* cpu, Bus* bus, AddrMode mode){
-  uint16_t lowByte, highByte, byte, addr, currPage, newPage;
-  uint8_t zeroPageAddr;
-  switch(mode){
-    case immediate:
-      return readBus(bus, ++cpu->pc);
-    case accumulator:
-      return cpu->a;
-    case relative:
-      return readBus(bus, ++cpu->pc);
-      
-    case absolute:
-      lowByte = readBus(bus, ++cpu->pc);
-      highByte = readBus(bus, ++cpu->pc);
-
-      return readBus(bus, (highByte << 8) + lowByte);
-
-    case absoluteX:        
-      lowByte = readBus(bus, ++cpu->pc); 
-      highByte = readBus(bus, ++cpu->pc); 
-      currPage = ((highByte << 8) | lowByte) & 0xff00;
-      newPage = (((highByte << 8) | lowByte) + cpu->x) & 0xff00;
-      if(currPage == newPage){
-        pageFlag = 0;
-      } else {
-        pageFlag = 1;
-      }
-      return readBus(bus, (highByte << 8) + lowByte + cpu->x);
-
-    case absoluteY:
-      lowByte = readBus(bus, ++cpu->pc); 
-      highByte = readBus(bus, ++cpu->pc);
-      currPage = ((highByte << 8) | lowByte) & 0xff00;
-      newPage = (((highByte << 8) | lowByte) + cpu->y) & 0xff00;
-      if(currPage == newPage){
-        pageFlag = 0;
-      } else {
-        pageFlag = 1;
-      } 
-      return readBus(bus, (highByte << 8) + lowByte + cpu->y);
-
-    case zeroPage:
-      lowByte = readBus(bus, ++cpu->pc);
-      return readBus(bus, lowByte);
-
-    case zeroPageX:
-      zeroPageAddr = readBus(bus, ++cpu->pc);
-      //printf("doing zeropagex with %d \n", cpu->pc);
-      zeroPageAddr = zeroPageAddr + cpu->x;
-      return readBus(bus, zeroPageAddr);
-    
-    case zeroPageY:
-      zeroPageAddr = readBus(bus, ++cpu->pc);
-      return readBus(bus, zeroPageAddr = zeroPageAddr + cpu->y);
-      
-    case indirectX:
-      lowByte = readBus(bus, (uint8_t)(cpu->x + readBus(bus, ++cpu->pc))); 
-      //printf("Reading low byte %d \n", readBus(bus, (uint8_t)(cpu->x + readBus(bus, cpu->pc))));
-
-      highByte = readBus(bus, (uint8_t)(cpu->x + readBus(bus, cpu->pc) + 1)); 
-      //printf("Reading low byte %d \n", lowByte);
-      //printf("Reading high byte %d \n", highByte);
-      //printf("Doing indirect-x \n");
-      // reads zero page
-      return readBus(bus, (highByte << 8) | lowByte);
-      
-    case indirectY:
-      zeroPageAddr = readBus(bus, ++cpu->pc); 
-      lowByte = readBus(bus, zeroPageAddr);
-      highByte = readBus(bus, ++zeroPageAddr);
-      currPage = ((highByte << 8) | lowByte) & 0xff00;
-      newPage = (((highByte << 8) | lowByte) + cpu->y) & 0xff00;
-      if(currPage == newPage){
-        pageFlag = 0;
-      } else {
-        pageFlag = 1;
-      }
-      return readBus(bus, ((highByte << 8) | lowByte) + cpu->y);
-    default:
-      halt(cpu);
-      return 0;
-    
-      
-  } 
-
-
-
 }
 
 
 void pushStack(CPU* cpu, Bus* bus, uint8_t val){
-  writeBus(bus, 0x0100 | ((uint16_t)cpu->sp), val);
-  cpu->sp--;
+  stackPush(cpu, bus, val);
 }
 
 uint8_t popStack(CPU* cpu, Bus* bus){
-  uint8_t temp = readBus(bus, 0x0100 | ((uint16_t)(++cpu->sp)));
-  return temp;
+  return stackPop(cpu, bus);
 }
 
-void checkNFlag(CPU* cpu, uint8_t val){
-  if(getBit(val, N)){
-    cpu->pf = setBit(cpu->pf, N);
-  } else {
-    cpu->pf = clearBit(cpu->pf, N);
-  }
-}
-
-
-
-
-void checkVFlag(CPU* cpu, uint8_t val, uint8_t prevVal, uint8_t operationFlag){
-  
-
-  uint8_t cf = 0;
-
-  if(operationFlag == SUB || operationFlag == ADD){
-    cf = (~(prevVal ^ val) & (prevVal ^ cpu->a)) & 0x80;
-
-
-    if(cf != 0){
-      cpu->pf = setBit(cpu->pf, V);
-    } else {
-      cpu->pf = clearBit(cpu->pf, V);
-    }
-  }
-  
-}
-
-// special checkVFlag function specifically made for the bit instruction since
-// that instruction affects the V flag differently than other instructions
-// input:
-//   cpu - cpu in question 
-//   val - value to test the V flag for (being the value at the memory location)
-void checkVFlagForBit(CPU* cpu, uint8_t val){
-  if(getBit(val,6) != 0){
-    cpu->pf = setBit(val, V);
-  } else {
-    cpu->pf = clearBit(val, V);
-  }
-
-
+// getStatus()
+//   packs the processor flags into a status byte, in the same layout as they get pushed onto the stack
+uint8_t getStatus(CPU* cpu){
+  return packStatus(cpu);
 }
 
-void checkZFlag(CPU* cpu, uint8_t val){
-  if(val == 0){
-    cpu->pf = setBit(cpu->pf, Z);
-  } else {
-    cpu->pf = clearBit(cpu->pf, Z);
-  }
-}
-
-// operationFlag refers to whether an add, sub, ror, or rol operation occured 
-// and will check the Carry Flag accordingly
-//
-// checkCFlag will perform a bitwise operation bit by bit, 
-// and on the 7th-position or 1st-position bit, 
-// it will check to see whether the carry was set
-// and set the cpu flag to that
-//
-// operand1 - is the value after the operation was performed
-// operand2 - is the value before the operation will be performed
-void checkCFlag(CPU* cpu, uint8_t operand1, uint8_t operand2, uint8_t operationFlag){
-  uint8_t bit1;
-  uint8_t bit2;
-  uint8_t carry = 0;
-
-
-  // TODO: check to see how this function works (?)
-  //
-
-  if(operationFlag == ROTATEL || operationFlag == SHIFTL){
-    // operand2 becomes value before the operation was performed
-    // operand1 becomes value after the operation was performed
-    //fputs("shiftl or rotatel \n", stdout);
-    //printf("cpu->pf %d \n", cpu->pf);
-    //if(getBit(operand2, 7) != 0){
-    //  cpu->pf = setBit(cpu->pf, 0);
-    //} else {
-    //  cpu->pf = clearBit(cpu->pf, 0);
-    //}
-    cpu->pf = (getBit(operand2, 7) != 0 ? setBit(cpu->pf, C) : clearBit(cpu->pf, C));
-    //printf("cpu->pf %d \n", cpu->pf);
-    //printf("cpu->pf %d \n",  getBit(operand2, 7) == 0 ? setBit(cpu->pf, 7) : clearBit(cpu->pf, 7));
-    return;
-  } else if(operationFlag == ROTATER){
-    if(getBit(operand2, 0) != 0){
-      cpu->pf = setBit(cpu->pf, C);
-    } else {
-      cpu->pf = clearBit(cpu->pf, C);
-    }
-    //cpu->pf = setBit(cpu->pf, getBit(operand2, 0));
-    return;
-  } 
-
-  /*else if(operationFlag == ADD){
-    if((operand1 + operand2) <= 255){
-      cpu->pf = clearBit(cpu->pf, C);
-    } else {
-      cpu->pf = setBit(cpu->pf, C);
-    }
-  }*/
-     
-
-  if(operationFlag == SHIFTL){
-    // operand2 becomes value before the operation was performed
-    // operand1 becomes value after the operation was performed
-
-
-  }
-
-  // find twos complement of a number
-  if(operationFlag == SUB){
-    //operand2 = ~operand2;
-    //int8_t tempoper1 = (int8_t)operand1;  
-    //int8_t tempoper2 = (int8_t)operand2;  
-    //if(tempoper1 - tempoper2 < 0){
-    //  
-    //}
-    
-  }
-
-  
-  for(int i = 0; i <= 7; ++i){
-    bit1 = getBit(operand1, i) >> i; 
-    bit2 = getBit(operand2, i) >> i; 
-    //printf("iteration %d \n", i);
-    //printf("bit1 %d \n", bit1);
-    //printf("bit2 %d \n", bit2);
-    //printf("carry %d \n", carry);
-    if(i == 0 && bit1 + bit2 + carry + getBit(cpu->pf, C) >= 2){
-      carry = 1;
-      continue;
-    } 
-    if(bit1 + bit2 + carry >= 2){
-      carry = 1;
-    } else {
-      carry = 0;
-    }
-  }
-  if(carry == 1){
-    //printf("Setting carry! \n");
-    cpu->pf = setBit(cpu->pf, C);
-  } else {
-    //printf("Clearing carry! \n");
-    cpu->pf = clearBit(cpu->pf, C);
-  }
+// setStatus()
+//   sets every processor flag from a status byte
+void setStatus(CPU* cpu, uint8_t val){
+  unpackStatus(cpu, val);
 }
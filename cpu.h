@@ -33,14 +33,9 @@ typedef struct _Bus Bus;
 // U is used to denote the unused flag, always pushed as a one
 enum flagBits {C, Z, I, D, B, U, V, N};
 
-#define ADD 0
-#define SUB 1
-#define ROTATEL 2
-#define ROTATER 3
-#define SHIFTL 4
 
 typedef enum {immediate, accumulator, absolute, absoluteX, absoluteY, absoluteIndir, 
-  zeroPage, zeroPageX, zeroPageY, indirectX, indirectY, relative, indirect}AddrMode;
+  zeroPage, zeroPageX, zeroPageY, indirectX, indirectY, relative, indirect, implied}AddrMode;
 
 
 typedef struct _CPU {
@@ -52,17 +47,31 @@ typedef struct _CPU {
   uint16_t pc; 
   uint16_t addrBus;
   uint8_t dataBus;
+
+  // cycles run so far in a batch that the scheduler's clock doesn't include yet, only non zero inside execute(), executeCached() and jitExecute()
   int cycles;
 
   // processor flags
+  // only I, D, B and U are kept in here, use getStatus() and setStatus() for the whole status byte
   uint8_t pf; 
 
+  // N, Z, C and V are worked out lazily (see instructions.h)
+  //   N is bit 7 of nResult, Z is set when zResult is 0
+  //   carry and overflow are 0 or 1
+  uint8_t nResult;
+  uint8_t zResult;
+  uint8_t carry;
+  uint8_t overflow;
+
 
   // used for the calculation of the carry flag
   uint8_t prevpf;
 
   // causes microprocessor to halt 
   int haltFlag;
+
+  // set by readOperand() to denote whether the resolved address crossed a page boundary
+  int pageFlag;
   
 
   int nmiInterruptFlag;
@@ -74,14 +83,9 @@ typedef struct _CPU {
 uint8_t readBus(Bus*, uint16_t);
 void writeBus(Bus*, uint16_t, uint8_t);
 
+// runs instructions until at least the given amount of cycles have been taken, returns the cycles taken
 int execute(CPU*, Bus*, int);
 
-// ** Global Variables **
-//
-// pageFlag is used in addressModeDecode to denote whether
-// the resolved address crossing page boundaries
-extern int pageFlag;
-
 //void adc(CPU*, Bus*, uint16_t, uint8_t, addrMode);
 //void and(CPU*, Bus*, uint16_t, uint8_t, addrMode); 
 //void asl(Machine*, uint16_t, uint8_t, addrMode); 
@@ -97,81 +101,58 @@ void checkForInterrupts(CPU*, Bus*);
 int decodeAndExecute(CPU*, Bus*, uint8_t);
 
 
-int adc(CPU*, Bus*, AddrMode);
-int and(CPU*, Bus*, AddrMode);
-int asl(CPU*, Bus*, AddrMode);
-int bcc(CPU*, Bus*);
-int bcs(CPU*, Bus*);
-int beq(CPU*, Bus*);
-int bit(CPU*, Bus*, AddrMode);
-int bmi(CPU*, Bus*);
-int bne(CPU*, Bus*);
-int bpl(CPU*, Bus*);
-int bvc(CPU*, Bus*);
-int bvs(CPU*, Bus*);
+// opcode handlers, generated from OPCODE_LIST in opcodes.h
+// each one executes a single instruction and returns the cycles it took
+typedef int (*OpHandler)(CPU*, Bus*);
+
+// indexed by opcode, NULL for illegal opcodes
+extern OpHandler const opTable[256];
+
+// base cycles of each opcode, not including page crossings or taken branches
+extern const uint8_t opCycles[256];
+
+// length of each opcode in bytes, including the opcode itself
+extern const uint8_t opLength[256];
+
+
+// ** Decode Cache **
+//
+// instructions that have already been fetched and decoded, kept per memory block in Mem.decoded
+// and looked up through Bus.decodedPages. see decodeAndExecuteCached()
+
+// same as an OpHandler, but is given the instruction's operand instead of fetching it
+typedef int (*DecodedHandler)(CPU*, Bus*, uint16_t);
+
+typedef struct _DecodedOp {
+  // NULL if the instruction at this address hasn't been decoded yet
+  DecodedHandler handler;
+
+  // operand bytes following the opcode, little endian
+  uint16_t operand;
+
+  // length in bytes and base cycles, same as opLength and opCycles
+  uint8_t length;
+  uint8_t cycles;
+
+  // if not 0, this instruction and the ones after it make up an idiom that executeCached() runs in one go (see cpu.c)
+  uint8_t fused;
+} DecodedOp;
+
+extern DecodedHandler const decodedOpTable[256];
+
+int decodeAndExecuteCached(CPU*, Bus*);
+
+// runs instructions through the decode cache until at least the given amount of cycles have been taken, returns the cycles taken
+int executeCached(CPU*, Bus*, int);
+
+// checks executeCached() against decodeAndExecute() on random roms made of the fused idioms, returns the number of mismatches
+int checkFusedOps(int, int);
+
 void halt(CPU*);
 
-int clc(CPU*);
-int cld(CPU*);
-int cli(CPU*);
-int clv(CPU*);
-int cmp(CPU*, Bus*, AddrMode);
-
-int cpx(CPU*, Bus*, AddrMode);
-int cpy(CPU*, Bus*, AddrMode);
-int dec(CPU*, Bus*, AddrMode);
-int dex(CPU*, Bus*);
-int dey(CPU*);
-int eor(CPU*, Bus*, AddrMode);
-int inc(CPU*, Bus*, AddrMode);
-int inx(CPU*);
-int iny(CPU*);
-
-int jmp(CPU*, Bus*, AddrMode);
-int jsr(CPU*, Bus*);
-
-
-int lda(CPU*, Bus*, AddrMode);
-int ldx(CPU*, Bus*, AddrMode);
-int ldy(CPU*, Bus*, AddrMode);
-int lsr(CPU*, Bus*, AddrMode);
-int nop(CPU*);
-
-int ora(CPU*, Bus*, AddrMode);
-
-int pha(CPU*, Bus*);
-int php(CPU*, Bus*);
-int pla(CPU*, Bus*);
-int plp(CPU*, Bus*);
-
-int rol(CPU*, Bus*, AddrMode);
-int ror(CPU*, Bus*, AddrMode);
-int rti(CPU*, Bus*);
-int rts(CPU*, Bus*);
-
-int sec(CPU*, Bus*);
-int sei(CPU*, Bus*);
-int sed(CPU*);
-
-int sbc(CPU*, Bus*, AddrMode);
-int sta(CPU*, Bus*, AddrMode);
-int stx(CPU*, Bus*, AddrMode);
-int sty(CPU*, Bus*, AddrMode);
-
-int tax(CPU*);
-int tay(CPU*);
-int tsx(CPU*);
-int txa(CPU*);
-int txs(CPU*);
-int tya(CPU*);
-
-void checkNFlag(CPU*, uint8_t);
-void checkVFlag(CPU*, uint8_t, uint8_t, uint8_t);
-void checkZFlag(CPU*, uint8_t);
-void checkCFlag(CPU*, uint8_t, uint8_t, uint8_t);
-
-uint8_t addressModeDecode(CPU*, Bus*, AddrMode);
-void addressModeDecodeWrite(uint8_t, CPU*, Bus*, AddrMode);
+uint8_t getStatus(CPU*);
+void setStatus(CPU*, uint8_t);
+
 
 void pushStack(CPU*, Bus*, uint8_t);
 uint8_t popStack(CPU*, Bus*);
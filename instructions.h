@@ -0,0 +1,918 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+#pragma once
+#include "cpu.h"
+
+// instructions.h
+//   the addressing modes and instructions of the 6502, as inline functions. included by cpu.c to build the
+//   opcode handlers, and by the c that --translate generates (see aot.c) so that it can inline them as well
+
+
+// CPU_INLINE
+//   used on the addressing mode and instruction functions below so that they get inlined into
+//   every opcode handler and translated block, letting the compiler fold away the switches on the addressing mode
+#define CPU_INLINE static inline __attribute__((always_inline))
+
+
+// OPERAND_LENGTH()
+//   how many bytes the operand of an instruction with the given addressing mode takes up.
+//   a macro so it can be used to build the opLength table
+#define OPERAND_LENGTH(mode) \
+  (((mode) == absolute || (mode) == absoluteX || (mode) == absoluteY || (mode) == absoluteIndir) ? 2 : \
+   ((mode) == implied || (mode) == accumulator) ? 0 : 1)
+
+CPU_INLINE int operandLength(AddrMode mode){
+  return OPERAND_LENGTH(mode);
+}
+
+
+// fetchOperand()
+//   reads the operand bytes that follow the opcode at the program counter, without moving it.
+//   two byte operands are returned as a little endian 16 bit value
+CPU_INLINE uint16_t fetchOperand(CPU* cpu, Bus* bus, AddrMode mode){
+  uint16_t lowByte, highByte;
+  switch(operandLength(mode)){
+    case 2:
+      lowByte = readBus(bus, cpu->pc + 1);
+      highByte = readBus(bus, cpu->pc + 2);
+      return (highByte << 8) | lowByte;
+    case 1:
+      return readBus(bus, cpu->pc + 1);
+    default:
+      return 0;
+  }
+}
+
+
+// resolveAddress()
+//   works out the effective address the operand of the current instruction refers to, for the addressing modes
+//   that refer to memory. the indexed modes set cpu->pageFlag to whether the index crossed into the next page.
+//   instructions that both read and write memory resolve the address once and use it for both, so the pointer
+//   of an indirect mode is only read from the zero page once. doesn't move the program counter
+CPU_INLINE uint16_t resolveAddress(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint16_t lowByte, highByte, address;
+  uint8_t zeroPageAddr;
+
+  switch(mode){
+    case absolute:
+    case zeroPage:
+      return operand;
+
+    case absoluteX:
+      address = operand + cpu->x;
+      cpu->pageFlag = (address & 0xff00) != (operand & 0xff00);
+      return address;
+
+    case absoluteY:
+      address = operand + cpu->y;
+      cpu->pageFlag = (address & 0xff00) != (operand & 0xff00);
+      return address;
+
+    // the zero page indexed modes wrap around within the zero page
+    case zeroPageX:
+      zeroPageAddr = operand;
+      zeroPageAddr = zeroPageAddr + cpu->x;
+      return zeroPageAddr;
+
+    case zeroPageY:
+      zeroPageAddr = operand;
+      zeroPageAddr = zeroPageAddr + cpu->y;
+      return zeroPageAddr;
+
+    // the low and high bytes are in the zero page, and their contents will yield our effective address
+    case indirectX:
+      lowByte = readBus(bus, (uint8_t)(cpu->x + operand));
+      highByte = readBus(bus, (uint8_t)(cpu->x + operand + 1));
+      return (highByte << 8) | lowByte;
+
+    case indirectY:
+      zeroPageAddr = operand;
+      lowByte = readBus(bus, zeroPageAddr);
+      highByte = readBus(bus, ++zeroPageAddr);
+      address = ((highByte << 8) | lowByte) + cpu->y;
+      cpu->pageFlag = (address & 0xff00) != (highByte << 8);
+      return address;
+
+    default:
+      return 0;
+  }
+}
+
+
+// readOperand()
+//   reads the value the operand of the current instruction refers to, for the given addressing mode.
+//   the program counter is left on the last byte of the instruction
+CPU_INLINE uint8_t readOperand(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->pc += operandLength(mode);
+  switch(mode){
+    case immediate:
+      return operand;
+    case accumulator:
+      return cpu->a;
+    case relative:
+      return operand;
+
+    case absolute:
+    case absoluteX:
+    case absoluteY:
+    case zeroPage:
+    case zeroPageX:
+    case zeroPageY:
+    case indirectX:
+    case indirectY:
+      return readBus(bus, resolveAddress(cpu, bus, mode, operand));
+
+    default:
+      cpu->haltFlag = 1;
+      return 0;
+  }
+}
+
+
+// readModify(), writeModified()
+//   the read and the write of a read-modify-write instruction (asl, lsr, rol, ror, inc and dec), both to the
+//   accumulator or both to the address given by resolveAddress()
+CPU_INLINE uint8_t readModify(CPU* cpu, Bus* bus, AddrMode mode, uint16_t address){
+  if(mode == accumulator){
+    return cpu->a;
+  }
+  return readBus(bus, address);
+}
+
+CPU_INLINE void writeModified(uint8_t value, CPU* cpu, Bus* bus, AddrMode mode, uint16_t address){
+  if(mode == accumulator){
+    cpu->a = value;
+  } else {
+    writeBus(bus, address, value);
+  }
+}
+
+
+// pageCrossCycles()
+//   the extra cycle taken by indexed reads when the effective address crosses into the next page
+CPU_INLINE int pageCrossCycles(CPU* cpu, AddrMode mode){
+  if(mode == absoluteX || mode == absoluteY || mode == indirectY){
+    return cpu->pageFlag;
+  }
+  return 0;
+}
+
+
+// ***** Flags *****
+//
+// N, Z, C and V get set by almost every instruction but are only read by branches and when the
+// status gets pushed, so they aren't packed into cpu->pf as they are set. instead:
+//   N and Z are kept as the value they were last set from (nResult and zResult)
+//   C and V are kept as 0 or 1 (carry and overflow)
+// getStatus() puts them back together into a status byte
+
+
+// setNZ()
+//   N and Z for a result
+CPU_INLINE void setNZ(CPU* cpu, uint8_t val){
+  cpu->nResult = val;
+  cpu->zResult = val;
+}
+
+// flagN(), flagZ()
+//   the current N and Z flags, as 0 or 1
+CPU_INLINE int flagN(CPU* cpu){
+  return cpu->nResult >> 7;
+}
+
+CPU_INLINE int flagZ(CPU* cpu){
+  return cpu->zResult == 0;
+}
+
+// packStatus(), unpackStatus()
+//   what getStatus() and setStatus() do, inlined into the instructions
+CPU_INLINE uint8_t packStatus(CPU* cpu){
+  return (cpu->pf & 0x3c) | (cpu->nResult & 0x80) | (cpu->overflow << V) | ((cpu->zResult == 0) << Z) | cpu->carry;
+}
+
+CPU_INLINE void unpackStatus(CPU* cpu, uint8_t val){
+  cpu->pf = val;
+  cpu->nResult = val & 0x80;
+  cpu->zResult = !getBit(val, Z);
+  cpu->overflow = getBit(val, V) >> V;
+  cpu->carry = getBit(val, C);
+}
+
+
+// ***** Stack *****
+
+// stackPush(), stackPop()
+//   what pushStack() and popStack() do, inlined into the instructions
+CPU_INLINE void stackPush(CPU* cpu, Bus* bus, uint8_t val){
+  writeBus(bus, 0x0100 | ((uint16_t)cpu->sp), val);
+  cpu->sp--;
+}
+
+CPU_INLINE uint8_t stackPop(CPU* cpu, Bus* bus){
+  return readBus(bus, 0x0100 | ((uint16_t)(++cpu->sp)));
+}
+
+
+// ***** Instructions *****
+//
+// every instruction takes the addressing mode it's being run with and returns the amount of cycles it took
+// on top of the base cycles in OPCODE_LIST (page crossings and branches).
+// on return the program counter points to the next instruction
+
+
+CPU_INLINE int adc(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+
+
+  uint8_t value;
+  uint8_t prevA;
+  uint16_t sum;
+
+
+
+
+  value = readOperand(cpu, bus, mode, operand);
+  prevA = cpu->a;
+  sum = prevA + value + cpu->carry;
+  cpu->a = (uint8_t)sum;
+
+  // NV-BDIZC
+
+  cpu->overflow = ((~(prevA ^ value) & (prevA ^ cpu->a)) & 0x80) >> 7;
+  cpu->carry = sum >> 8;
+  setNZ(cpu, cpu->a);
+  cpu->pc++;
+  return pageCrossCycles(cpu, mode);
+
+}
+
+
+CPU_INLINE int and(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t value;
+  value = readOperand(cpu, bus, mode, operand);
+  cpu->a = cpu->a & value;
+
+  setNZ(cpu, cpu->a);
+
+  cpu->pc++;
+  return pageCrossCycles(cpu, mode);
+}
+
+
+CPU_INLINE int asl(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand) {
+    uint16_t address;
+    uint8_t value;
+    uint8_t prevValue;
+    address = resolveAddress(cpu, bus, mode, operand);
+    value = readModify(cpu, bus, mode, address);
+
+    // sets the carry bit to whatever the 7th position of the
+    // a register was, before the shift left occurs
+    prevValue = value;
+    value = value << 1;
+
+    setNZ(cpu, value);
+    cpu->carry = prevValue >> 7;
+
+    writeModified(value, cpu, bus, mode, address);
+    cpu->pc += operandLength(mode) + 1;
+    return 0;
+}
+
+
+CPU_INLINE int bcc(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  int8_t offset;
+  uint16_t page;
+  offset = readOperand(cpu, bus, relative, operand);
+  page = cpu->pc & 0xff00;
+  if(!cpu->carry){
+    cpu->pc += offset;
+  }
+  cpu->pc++;
+  if(page == (cpu->pc & 0xff00)){
+    return 1;
+  } else {
+    return 2;
+  }
+}
+
+
+CPU_INLINE int bcs(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  int8_t offset;
+  uint16_t page = cpu->pc & 0xff00;
+
+  offset = readOperand(cpu, bus, relative, operand);
+  if(cpu->carry){
+    cpu->pc += offset;
+  }
+
+  cpu->pc++;
+  if(page == (cpu->pc & 0xff00)){
+    return 1;
+  } else {
+    return 2;
+  }
+}
+
+CPU_INLINE int beq(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  int8_t offset;
+  uint16_t page = cpu->pc & 0xff00;
+
+  offset = readOperand(cpu, bus, relative, operand);
+  if(flagZ(cpu)){
+    cpu->pc += offset;
+  }
+  cpu->pc++;
+  if(page == (cpu->pc & 0xff00)){
+    return 1;
+  } else {
+    return 2;
+  }
+
+}
+
+
+CPU_INLINE int bit(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+
+  uint8_t value = readOperand(cpu, bus, mode, operand);
+  uint8_t prevValue = value;
+    value = value & cpu->a;
+    cpu->nResult = prevValue;
+    cpu->zResult = value;
+
+
+  // the BIT instruction copies bit 6 of the memory location straight into the V flag
+  cpu->overflow = (prevValue >> 6) & 1;
+  cpu->pc++;
+  return 0;
+
+}
+
+CPU_INLINE int bmi(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  int8_t offset;
+  int cycles = 0;
+
+  uint16_t page = cpu->pc & 0xff00;
+  offset = readOperand(cpu, bus, relative, operand);
+  if(flagN(cpu)){
+    cpu->pc += offset;
+    cycles += 1;
+  }
+  if(page == (cpu->pc & 0xff00)){
+    cycles += 2;
+  }
+  cpu->pc++;
+  return cycles;
+
+}
+
+CPU_INLINE int bne(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  int8_t offset;
+  uint16_t page = cpu->pc & 0xff00;
+  int cycles = 0;
+
+  offset = readOperand(cpu, bus, relative, operand);
+
+  if(!flagZ(cpu)){
+    cpu->pc += offset;
+    cycles = 1;
+  }
+  if(page == (cpu->pc & 0xff00)){
+    cycles += 2;
+  }
+  cpu->pc++;
+  return cycles;
+
+
+}
+
+CPU_INLINE int bpl(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  int8_t offset;
+  uint16_t page = cpu->pc & 0xff00;
+
+  int cycles = 0;
+  offset = (int8_t)readOperand(cpu, bus, relative, operand);
+  if(!flagN(cpu)){
+    cpu->pc += offset;
+  }
+
+  if(flagN(cpu)){
+    cycles += 1;
+  }
+  if(page == (cpu->pc & 0xff00)){
+    cycles += 2;
+  }
+  cpu->pc++;
+  return cycles;
+
+}
+
+
+// brk - software interrupt, also run by brki()
+CPU_INLINE int brk(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint16_t temp;
+
+  // break flag set to be prepared when pushed onto the stack
+  cpu->pf = setBit(cpu->pf, 4);
+
+  // push the msb and lsb of the program counter+2 onto the stack
+  temp = cpu->pc + 2;
+  stackPush(cpu, bus, (uint8_t)((temp & 0xff00) >> 8));
+  stackPush(cpu, bus, (uint8_t)(temp & 0x00ff));
+
+  // pushes the processor flags onto the stack
+  stackPush(cpu, bus, packStatus(cpu));
+
+  // sets the interupt disable flag
+  cpu->pf = setBit(cpu->pf, 2);
+
+  // break flag is now cleared because it only exists within the stack
+  cpu->pf = clearBit(cpu->pf, 4);
+
+  cpu->pc = readBus(bus, 0xfffe);
+  temp = (uint16_t)readBus(bus, 0xffff);
+  temp = temp << 8;
+  cpu->pc = cpu->pc | temp;
+
+  return 0;
+}
+
+CPU_INLINE int bvc(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  int8_t offset;
+  uint16_t page = cpu->pc & 0xff00;
+  int cycles = 0;
+  offset = readOperand(cpu, bus, relative, operand);
+  if(!cpu->overflow){
+    cpu->pc += offset;
+  }
+
+  if(!cpu->overflow){
+    cycles += 1;
+  }
+  if(page == (cpu->pc & 0xff00)){
+    cycles += 2;
+  }
+  cpu->pc++;
+  return cycles;
+}
+
+CPU_INLINE int bvs(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  int8_t offset;
+  uint16_t page = cpu->pc & 0xff00;
+  int cycles = 0;
+  offset = readOperand(cpu, bus, relative, operand);
+
+  if(cpu->overflow){
+    cpu->pc += offset;
+  }
+  if(cpu->overflow){
+    cycles += 1;
+  }
+  if(page == (cpu->pc & 0xff00)){
+    cycles += 2;
+  }
+  cpu->pc++;
+  return cycles;
+}
+
+CPU_INLINE int clc(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->carry = 0;
+  cpu->pc++;
+  return 0;
+}
+
+
+CPU_INLINE int plp(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  unpackStatus(cpu, stackPop(cpu, bus));
+  cpu->pf = setBit(cpu->pf, 5);
+  cpu->pf = clearBit(cpu->pf, 4);
+  cpu->pc++;
+  return 0;
+}
+
+
+CPU_INLINE int cld(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->pf = clearBit(cpu->pf, D);
+  cpu->pc++;
+  return 0;
+}
+
+
+CPU_INLINE int cli(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->pf = clearBit(cpu->pf, I);
+  cpu->pc++;
+  return 0;
+}
+
+CPU_INLINE int clv(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->overflow = 0;
+  cpu->pc++;
+  return 0;
+}
+
+CPU_INLINE int cmp(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t value;
+  value = readOperand(cpu, bus, mode, operand);
+
+  cpu->carry = value <= cpu->a;
+  value = cpu->a - value;
+
+  setNZ(cpu, value);
+
+  cpu->pc++;
+  return pageCrossCycles(cpu, mode);
+
+}
+
+CPU_INLINE int cpx(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+
+  uint8_t value = readOperand(cpu, bus, mode, operand);
+  cpu->carry = value <= cpu->x;
+  setNZ(cpu, cpu->x - value);
+  cpu->pc++;
+  return 0;
+
+}
+
+CPU_INLINE int cpy(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t value = readOperand(cpu, bus, mode, operand);
+  cpu->carry = cpu->y >= value;
+  setNZ(cpu, cpu->y - value);
+  cpu->pc++;
+  return 0;
+
+}
+
+CPU_INLINE int dec(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint16_t address = resolveAddress(cpu, bus, mode, operand);
+  uint8_t value = readModify(cpu, bus, mode, address);
+  value = value - 1;
+  setNZ(cpu, value);
+  writeModified(value, cpu, bus, mode, address);
+  cpu->pc += operandLength(mode) + 1;
+  return 0;
+
+}
+
+
+
+CPU_INLINE int dex(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->x--;
+  setNZ(cpu, cpu->x);
+  cpu->pc++;
+  return 0;
+}
+
+CPU_INLINE int dey(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->y--;
+  setNZ(cpu, cpu->y);
+  cpu->pc++;
+  return 0;
+}
+
+CPU_INLINE int eor(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t value = readOperand(cpu, bus, mode, operand);
+  cpu->a = cpu->a ^ value;
+  setNZ(cpu, cpu->a);
+  cpu->pc++;
+  return pageCrossCycles(cpu, mode);
+
+}
+
+CPU_INLINE int inc(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint16_t address = resolveAddress(cpu, bus, mode, operand);
+  uint8_t value = readModify(cpu, bus, mode, address);
+  value++;
+  setNZ(cpu, value);
+  writeModified(value, cpu, bus, mode, address);
+  cpu->pc += operandLength(mode) + 1;
+  return 0;
+
+}
+
+
+CPU_INLINE int inx(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->x++;
+  setNZ(cpu, cpu->x);
+  cpu->pc++;
+  return 0;
+
+
+}
+
+CPU_INLINE int iny(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->y++;
+  setNZ(cpu, cpu->y);
+  cpu->pc++;
+  return 0;
+
+}
+
+// jmp handles it's own address mode decoding, since readOperand is unable
+// return a 16 bit value
+// also Absolute Indirect is only used in JMP.
+CPU_INLINE int jmp(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t lowByte;
+  uint16_t highByte;
+
+  lowByte = operand & 0xff;
+  highByte = operand >> 8;
+
+  if(mode == absolute){
+    cpu->pc = operand;
+  } else if(mode == absoluteIndir){
+    // the high byte of the pointer doesn't get carried into when the low byte wraps around
+    cpu->pc = readBus(bus, operand) | (readBus(bus, (lowByte = lowByte + 1) | (highByte << 8)) << 8);
+
+  }
+  return 0;
+}
+
+
+// jsr - jump to subroutine
+// jumps to new address while pushing the contents of the program counter
+// onto the stack.
+CPU_INLINE int jsr(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  // the address pushed is the last byte of the jsr instruction
+  cpu->pc += 2;
+
+  stackPush(cpu, bus, (uint8_t)(cpu->pc >> 8));
+  stackPush(cpu, bus, (uint8_t)(cpu->pc & 0xff));
+  cpu->pc = operand;
+  return 0;
+}
+
+
+CPU_INLINE int lda(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t value = readOperand(cpu, bus, mode, operand);
+  cpu->a = value;
+  setNZ(cpu, cpu->a);
+  cpu->pc++;
+  return pageCrossCycles(cpu, mode);
+}
+
+CPU_INLINE int ldx(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t value = readOperand(cpu, bus, mode, operand);
+  cpu->x = value;
+  setNZ(cpu, cpu->x);
+  cpu->pc++;
+  return pageCrossCycles(cpu, mode);
+}
+
+
+CPU_INLINE int ldy(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t value = readOperand(cpu, bus, mode, operand);
+  cpu->y = value;
+  setNZ(cpu, cpu->y);
+  cpu->pc++;
+  return pageCrossCycles(cpu, mode);
+
+}
+
+CPU_INLINE int lsr(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint16_t address = resolveAddress(cpu, bus, mode, operand);
+  uint8_t value = readModify(cpu, bus, mode, address);
+  uint8_t prevValue = value;
+  value = value >> 1;
+  setNZ(cpu, value);
+  cpu->carry = prevValue & 1;
+  writeModified(value, cpu, bus, mode, address);
+  cpu->pc += operandLength(mode) + 1;
+  return 0;
+}
+
+CPU_INLINE int nop(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->pc++;
+  return 0;
+}
+
+CPU_INLINE int ora(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t value = readOperand(cpu, bus, mode, operand);
+  cpu->a = cpu->a | value;
+  setNZ(cpu, cpu->a);
+  cpu->pc++;
+  return pageCrossCycles(cpu, mode);
+}
+
+CPU_INLINE int pha(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  stackPush(cpu, bus, cpu->a);
+  cpu->pc++;
+  return 0;
+}
+
+
+CPU_INLINE int php(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t val;
+  val = setBit(packStatus(cpu), B);
+  stackPush(cpu, bus, val);
+  cpu->pc++;
+  return 0;
+}
+
+
+CPU_INLINE int pla(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->a = stackPop(cpu, bus);
+  setNZ(cpu, cpu->a);
+  cpu->pc++;
+  return 0;
+}
+
+
+CPU_INLINE int rol(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint16_t address = resolveAddress(cpu, bus, mode, operand);
+  uint8_t value = readModify(cpu, bus, mode, address);
+  uint8_t prevValue = value;
+
+  // sets the C Flag as bit 7 of the input
+
+
+  value = value << 1;
+
+  // sets bit 0 as the input carry (after the operation as taken place)
+  value = value | cpu->carry;
+
+  cpu->carry = prevValue >> 7;
+  setNZ(cpu, value);
+  writeModified(value, cpu, bus, mode, address);
+  cpu->pc += operandLength(mode) + 1;
+  return 0;
+
+}
+
+
+CPU_INLINE int ror(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint16_t address = resolveAddress(cpu, bus, mode, operand);
+  uint8_t value = readModify(cpu, bus, mode, address);
+  uint8_t prevValue = value;
+
+
+  value = value >> 1;
+
+  // sets bit 0 to the carry flag of the previous operation
+  value = value | (cpu->carry << 7);
+
+  cpu->carry = prevValue & 1;
+  setNZ(cpu, value);
+  writeModified(value, cpu, bus, mode, address);
+  cpu->pc += operandLength(mode) + 1;
+  return 0;
+
+}
+
+CPU_INLINE int rti(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+
+
+
+  unpackStatus(cpu, stackPop(cpu, bus));
+  cpu->pf = setBit(cpu->pf, U);
+  cpu->pc = (uint16_t)stackPop(cpu, bus);
+  cpu->pc = (cpu->pc | (((uint16_t)stackPop(cpu, bus)) << 8));
+
+
+  // clears the brk flag
+  //
+  cpu->pf = clearBit(cpu->pf, 4);
+
+  return 0;
+
+
+
+}
+
+CPU_INLINE int rts(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->pc = (uint16_t) stackPop(cpu, bus);
+  cpu->pc += (uint16_t) stackPop(cpu, bus) << 8;
+  cpu->pc++;
+  return 0;
+}
+
+CPU_INLINE int sec(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->carry = 1;
+  cpu->pc++;
+  return 0;
+}
+
+// this function sets the Decimal flag, but has no function since
+// decimal mode doesn't exist on the nes
+CPU_INLINE int sed(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->pf = setBit(cpu->pf, D);
+  cpu->pc++;
+  return 0;
+
+}
+CPU_INLINE int sei(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->pf = setBit(cpu->pf, I);
+  cpu->pc++;
+  return 0;
+}
+
+
+
+CPU_INLINE int sbc(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  uint8_t value = readOperand(cpu, bus, mode, operand);
+  uint8_t prevA = cpu->a;
+  uint16_t temp = 0;
+
+  // getting one's complement
+  value = ~value;
+  temp = value + prevA + cpu->carry;
+  cpu->a = (uint8_t)temp;
+
+
+  cpu->overflow = ((~(prevA ^ value) & (prevA ^ cpu->a)) & 0x80) >> 7;
+  setNZ(cpu, cpu->a);
+  cpu->carry = temp >> 8;
+
+  cpu->pc++;
+  return pageCrossCycles(cpu, mode);
+
+
+}
+
+
+
+// STA - store accumulator in memory
+CPU_INLINE int sta(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  writeBus(bus, resolveAddress(cpu, bus, mode, operand), cpu->a);
+  cpu->pc += operandLength(mode) + 1;
+  return 0;
+
+}
+
+CPU_INLINE int stx(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  writeBus(bus, resolveAddress(cpu, bus, mode, operand), cpu->x);
+  cpu->pc += operandLength(mode) + 1;
+  return 0;
+}
+
+
+CPU_INLINE int sty(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  writeBus(bus, resolveAddress(cpu, bus, mode, operand), cpu->y);
+  cpu->pc += operandLength(mode) + 1;
+  return 0;
+
+}
+
+CPU_INLINE int tax(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->x = cpu->a;
+  setNZ(cpu, cpu->x);
+  cpu->pc++;
+  return 0;
+}
+
+
+CPU_INLINE int tay(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->y = cpu->a;
+  setNZ(cpu, cpu->y);
+  cpu->pc++;
+  return 0;
+}
+
+
+CPU_INLINE int tsx(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->x = cpu->sp;
+  setNZ(cpu, cpu->x);
+  cpu->pc++;
+  return 0;
+}
+
+CPU_INLINE int txa(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->a = cpu->x;
+  setNZ(cpu, cpu->a);
+  cpu->pc++;
+  return 0;
+}
+
+CPU_INLINE int txs(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->sp = cpu->x;
+  cpu->pc++;
+  return 0;
+}
+
+CPU_INLINE int tya(CPU* cpu, Bus* bus, AddrMode mode, uint16_t operand){
+  cpu->a = cpu->y;
+  setNZ(cpu, cpu->a);
+  cpu->pc++;
+  return 0;
+}
+
@@ -0,0 +1,617 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jit.h"
+#include "ppu.h"
+#include "opcodes.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+
+// The jit is call-threaded: a compiled block is a straight run of calls into the same opd_0xNN
+// handlers the decode cache uses (see decodedOpTable), with the operands baked in as immediates.
+// This gets rid of the fetch, decode and dispatch for every instruction while keeping the exact
+// same behaviour as the interpreter.
+//
+// After every instruction the block adds up the cycles and leaves once the budget has run out, so
+// it stops on the same instruction the interpreter would have.
+//
+// A block ends:
+//   - on any branch, jump, call, return or brk
+//   - before an instruction that is known to touch the ppu/apu/controller registers or a mapper
+//     register, so that those always go through the interpreter
+//   - after a store through an indirect address, since it could have switched banks
+//   - before an illegal opcode, or where the code runs off the end of the PRG bank
+//
+// Instructions with an indirect address (($zp,x) and ($zp),y) don't know what they touch until they run, so they
+// call jitIndirectOp() instead of their handler. It brings cpu->cycles up to date for the instruction and sends it
+// through the interpreter if it does touch io, the same as if the block had ended before it.
+
+
+// interpretInstruction()
+//   used as the block for any address that couldn't be compiled, just runs the one instruction
+static int interpretInstruction(CPU* cpu, Bus* bus, int budget){
+  if(bus->decodeCache == 1){
+    return decodeAndExecuteCached(cpu, bus);
+  }
+  return decodeAndExecute(cpu, bus, readBus(bus, cpu->pc));
+}
+
+
+#if JIT_SUPPORTED == 1
+
+#define JIT_NAME_ENTRY(opcode, instruction, mode, cycles) [opcode] = #instruction,
+#define JIT_MODE_ENTRY(opcode, instruction, mode, cycles) [opcode] = mode,
+
+static const char* const jitNames[256] = {
+  OPCODE_LIST(JIT_NAME_ENTRY)
+};
+
+static const AddrMode jitModes[256] = {
+  OPCODE_LIST(JIT_MODE_ENTRY)
+};
+
+
+// endsBlock()
+//   instructions that change the program counter, anything after them isn't known at compile time
+static int endsBlock(const char* name){
+  const char* enders[] = {"bcc", "bcs", "beq", "bmi", "bne", "bpl", "bvc", "bvs",
+                          "jmp", "jsr", "rts", "rti", "brk"};
+  for(int i = 0; i < (int)(sizeof(enders) / sizeof(enders[0])); ++i){
+    if(strcmp(name, enders[i]) == 0){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// writesMemory()
+//   stores and read-modify-write instructions that don't work on the accumulator
+static int writesMemory(const char* name, AddrMode mode){
+  const char* writers[] = {"sta", "stx", "sty", "asl", "lsr", "rol", "ror", "inc", "dec"};
+  if(mode == accumulator){
+    return 0;
+  }
+  for(int i = 0; i < (int)(sizeof(writers) / sizeof(writers[0])); ++i){
+    if(strcmp(name, writers[i]) == 0){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// rangeHitsIo()
+//   whether anything in start to start + length - 1 is something the jit shouldn't touch.
+//   for reads that's the ppu/apu/controller registers, for writes it's also the mapper registers
+static int rangeHitsIo(uint32_t start, uint32_t length, int write){
+  uint32_t addr;
+  for(uint32_t i = 0; i < length; ++i){
+    addr = (start + i) & 0xffff;
+    if(addr >= 0x2000 && addr <= 0x401f){
+      return 1;
+    }
+    if(write && (addr >= 0x4020 && !(addr >= 0x6000 && addr <= 0x7fff))){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// needsInterpreter()
+//   whether the instruction is known to touch io at compile time
+static int needsInterpreter(uint8_t oppCode, uint16_t operand){
+  AddrMode mode = jitModes[oppCode];
+  int write = writesMemory(jitNames[oppCode], mode);
+
+  // jsr and jmp absolute don't access their operand
+  if(strcmp(jitNames[oppCode], "jsr") == 0 || (strcmp(jitNames[oppCode], "jmp") == 0 && mode == absolute)){
+    return 0;
+  }
+
+  switch(mode){
+    // jmp indirect reads the pointer at its operand, its high byte never crosses into the next page
+    case absoluteIndir:
+      return rangeHitsIo(operand, 1, 0) || rangeHitsIo((operand & 0xff00) | ((operand + 1) & 0xff), 1, 0);
+    case absolute:
+      return rangeHitsIo(operand, 1, write);
+    case absoluteX:
+    case absoluteY:
+      return rangeHitsIo(operand, 0x100, write);
+    default:
+      return 0;
+  }
+}
+
+
+// jitIndirectOp()
+//   called by a compiled block in place of the handler of an instruction with an indirect address, see the top of the file.
+//   the same pointer lookup as resolveAddress(), the pointer is in the zero page so reading it here has no side effects.
+//   inputs:
+//     taken - cycles the block has taken so far, cpu->cycles is still where jitExecute() left it
+//     write - 1 if the instruction writes to its address, worked out when the block was compiled
+//   returns the cycles the instruction took
+static int jitIndirectOp(CPU* cpu, Bus* bus, uint16_t operand, uint8_t oppCode, int taken, int write){
+  int start = cpu->cycles;
+  uint16_t address;
+  int cycles;
+
+  if(jitModes[oppCode] == indirectX){
+    address = readBus(bus, (uint8_t)(cpu->x + operand)) | (readBus(bus, (uint8_t)(cpu->x + operand + 1)) << 8);
+  } else {
+    address = (readBus(bus, (uint8_t)operand) | (readBus(bus, (uint8_t)(operand + 1)) << 8)) + cpu->y;
+  }
+
+  cpu->cycles = start + taken;
+  if(rangeHitsIo(address, 1, write)){
+    cycles = decodeAndExecute(cpu, bus, oppCode);
+  } else {
+    cycles = decodedOpTable[oppCode](cpu, bus, operand);
+  }
+  cpu->cycles = start;
+  return cycles;
+}
+
+
+// emit helpers, for writing machine code into the code buffer
+static void emit8(Jit* jit, uint8_t byte){
+  jit->code[jit->codeUsed++] = byte;
+}
+
+static void emitBytes(Jit* jit, const uint8_t* bytes, int length){
+  memcpy(jit->code + jit->codeUsed, bytes, length);
+  jit->codeUsed += length;
+}
+
+static void emit32(Jit* jit, uint32_t val){
+  memcpy(jit->code + jit->codeUsed, &val, 4);
+  jit->codeUsed += 4;
+}
+
+static void emit64(Jit* jit, uint64_t val){
+  memcpy(jit->code + jit->codeUsed, &val, 8);
+  jit->codeUsed += 8;
+}
+
+
+// setCodeWritable()
+//   the code buffer is never writable and executable at the same time (W^X). it's only made writable while
+//   compileBlock() writes a block into it, and is executable the rest of the time
+static void setCodeWritable(Jit* jit, int writable){
+  if(mprotect(jit->code, jit->codeSize, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) != 0){
+    printf("jit: could not change the protection of the code buffer \n");
+    exit(1);
+  }
+}
+
+
+// compileBlock()
+//   compiles the block starting at the program counter. returns interpretInstruction if not even
+//   the first instruction can be compiled
+static JitBlock compileBlock(CPU* cpu, Bus* bus, JitBlock* entry){
+  Jit* jit = bus->jit;
+  uint16_t addr = cpu->pc;
+  uint8_t oppCode;
+  uint16_t operand;
+  int length;
+  int count = 0;
+  int exitJumps[JIT_MAX_INSTRUCTIONS];
+  uint8_t* start;
+
+  // worst case size of a block, leaving some room for the prologue and epilogue
+  if(jit->codeUsed + 64 + JIT_MAX_INSTRUCTIONS * 56 > jit->codeSize){
+    flushJit(bus);
+  }
+  start = jit->code + jit->codeUsed;
+  setCodeWritable(jit, 1);
+
+  // push rbx, push r12, push r13, push r14, sub rsp 8 (keeps the stack 16 byte aligned for the calls)
+  // then rbx = cpu, r12 = bus, r13d = budget, r14d = cycles taken
+  const uint8_t prologue[] = {0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x48, 0x83, 0xec, 0x08,
+                              0x48, 0x89, 0xfb, 0x49, 0x89, 0xf4, 0x41, 0x89, 0xd5, 0x45, 0x31, 0xf6};
+  emitBytes(jit, prologue, sizeof(prologue));
+
+  while(count < JIT_MAX_INSTRUCTIONS){
+    oppCode = readBus(bus, addr);
+    if(decodedOpTable[oppCode] == NULL){
+      break;
+    }
+    length = opLength[oppCode];
+
+    // every byte of the instruction has to come from the same PRG bank as the start of the block
+    if((uint32_t)addr + length - 1 > 0xffff){
+      break;
+    }
+    if(bus->jitPages[(addr + length - 1) >> 8] == NULL ||
+       bus->jitPages[(addr + length - 1) >> 8] + ((addr + length - 1) & 0xff) != entry + (addr + length - 1 - cpu->pc)){
+      break;
+    }
+
+    operand = 0;
+    if(length > 1){
+      operand = readBus(bus, addr + 1);
+    }
+    if(length > 2){
+      operand |= ((uint16_t)readBus(bus, addr + 2)) << 8;
+    }
+
+    if(needsInterpreter(oppCode, operand)){
+      break;
+    }
+
+    // mov rdi, rbx ; mov rsi, r12 ; mov edx, operand ; mov rax, handler ; call rax
+    const uint8_t args[] = {0x48, 0x89, 0xdf, 0x4c, 0x89, 0xe6};
+    emitBytes(jit, args, sizeof(args));
+    emit8(jit, 0xba);
+    emit32(jit, operand);
+    if(jitModes[oppCode] == indirectX || jitModes[oppCode] == indirectY){
+      // jitIndirectOp() also gets the opcode, the cycles taken so far and whether it writes
+      // (mov ecx, opcode ; mov r8d, r14d ; mov r9d, write)
+      const uint8_t taken[] = {0x45, 0x89, 0xf0};
+      emit8(jit, 0xb9);
+      emit32(jit, oppCode);
+      emitBytes(jit, taken, sizeof(taken));
+      emit8(jit, 0x41);
+      emit8(jit, 0xb9);
+      emit32(jit, writesMemory(jitNames[oppCode], jitModes[oppCode]));
+      emit8(jit, 0x48);
+      emit8(jit, 0xb8);
+      emit64(jit, (uint64_t)(uintptr_t)jitIndirectOp);
+    } else {
+      emit8(jit, 0x48);
+      emit8(jit, 0xb8);
+      emit64(jit, (uint64_t)(uintptr_t)decodedOpTable[oppCode]);
+    }
+    emit8(jit, 0xff);
+    emit8(jit, 0xd0);
+
+    // add r14d, eax ; cmp r14d, r13d ; jge exit
+    const uint8_t account[] = {0x41, 0x01, 0xc6, 0x45, 0x39, 0xee, 0x0f, 0x8d};
+    emitBytes(jit, account, sizeof(account));
+    exitJumps[count] = jit->codeUsed;
+    emit32(jit, 0);
+
+    count++;
+    addr += length;
+
+    if(endsBlock(jitNames[oppCode])){
+      break;
+    }
+    // a store through a pointer could have written to a mapper register
+    if(writesMemory(jitNames[oppCode], jitModes[oppCode]) && (jitModes[oppCode] == indirectX || jitModes[oppCode] == indirectY)){
+      break;
+    }
+  }
+
+  if(count == 0){
+    jit->codeUsed = start - jit->code;
+    setCodeWritable(jit, 0);
+    return interpretInstruction;
+  }
+
+  // point all of the budget checks at the epilogue
+  for(int i = 0; i < count; ++i){
+    uint32_t rel = jit->codeUsed - (exitJumps[i] + 4);
+    memcpy(jit->code + exitJumps[i], &rel, 4);
+  }
+
+  // mov eax, r14d ; add rsp 8 ; pop r14 ; pop r13 ; pop r12 ; pop rbx ; ret
+  const uint8_t epilogue[] = {0x44, 0x89, 0xf0, 0x48, 0x83, 0xc4, 0x08,
+                              0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5b, 0xc3};
+  emitBytes(jit, epilogue, sizeof(epilogue));
+
+  setCodeWritable(jit, 0);
+  jit->blocksCompiled++;
+  return (JitBlock)(void*)start;
+}
+
+#endif
+
+
+// initJitBlocks()
+//   sets up the table of blocks for the PRG-ROM on the bus, without a code buffer to compile anything into. on its own
+//   every address without a block is interpreted, which is how the blocks translated ahead of time are run (see aot.c).
+//   has to be called after the memory blocks have been allocated.
+//   if check is 1, every block is run against the interpreter as well (slow).
+void initJitBlocks(Bus* bus, int check){
+  Jit* jit = calloc(1, sizeof(Jit));
+
+  jit->check = check;
+
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    if(bus->memArr[i].type == Rom && bus->memArr[i].contents != NULL){
+      bus->memArr[i].jitBlocks = calloc(bus->memArr[i].size, sizeof(JitBlock));
+    }
+  }
+
+  if(check == 1){
+    jit->ramBefore = calloc(bus->numOfBlocks, sizeof(uint8_t*));
+    jit->ramAfter = calloc(bus->numOfBlocks, sizeof(uint8_t*));
+    for(int i = 0; i < bus->numOfBlocks; ++i){
+      if(bus->memArr[i].type == Ram && bus->memArr[i].contents != NULL){
+        jit->ramBefore[i] = malloc(bus->memArr[i].size);
+        jit->ramAfter[i] = malloc(bus->memArr[i].size);
+      }
+    }
+  }
+
+  bus->jit = jit;
+  updatePageTable(bus);
+}
+
+
+// initJit()
+//   sets up the jit for the PRG-ROM on the bus. has to be called after the memory blocks have been allocated.
+//   if check is 1, every block is run against the interpreter as well (slow).
+//   returns 1 on success, 0 if the jit isn't supported
+int initJit(Bus* bus, int check){
+#if JIT_SUPPORTED == 1
+  // mapped writable, then made executable instead, see setCodeWritable()
+  uint8_t* code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if(code == MAP_FAILED){
+    printf("jit: could not map memory for the code buffer \n");
+    return 0;
+  }
+  // hardened kernels and selinux's execmem policy can refuse to make it executable
+  if(mprotect(code, JIT_CODE_SIZE, PROT_READ | PROT_EXEC) != 0){
+    printf("jit: could not make the code buffer executable \n");
+    munmap(code, JIT_CODE_SIZE);
+    return 0;
+  }
+
+  initJitBlocks(bus, check);
+  bus->jit->code = code;
+  bus->jit->codeSize = JIT_CODE_SIZE;
+  bus->jit->codeUsed = 0;
+  return 1;
+#else
+  printf("jit: only supported on x86-64 linux \n");
+  return 0;
+#endif
+}
+
+
+// freeJit()
+void freeJit(Bus* bus){
+  Jit* jit = bus->jit;
+  if(jit == NULL){
+    return;
+  }
+
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    free(bus->memArr[i].jitBlocks);
+    bus->memArr[i].jitBlocks = NULL;
+    if(jit->check == 1){
+      free(jit->ramBefore[i]);
+      free(jit->ramAfter[i]);
+    }
+  }
+  for(int i = 0; i < jit->numOfVramBlocks; ++i){
+    free(jit->vramBefore[i]);
+    free(jit->vramAfter[i]);
+  }
+  free(jit->ramBefore);
+  free(jit->ramAfter);
+  free(jit->vramBefore);
+  free(jit->vramAfter);
+#if JIT_SUPPORTED == 1
+  if(jit->code != NULL){
+    munmap(jit->code, jit->codeSize);
+  }
+#endif
+  free(jit);
+  bus->jit = NULL;
+  updatePageTable(bus);
+}
+
+
+// flushJit()
+//   throws away every compiled block. blocks that weren't compiled into the code buffer (translated ahead of time,
+//   or interpretInstruction) are kept
+void flushJit(Bus* bus){
+  Jit* jit = bus->jit;
+  uint8_t* block;
+
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    if(bus->memArr[i].jitBlocks == NULL){
+      continue;
+    }
+    for(int j = 0; j < bus->memArr[i].size; ++j){
+      block = (uint8_t*)(void*)bus->memArr[i].jitBlocks[j];
+      if(block >= jit->code && block < jit->code + jit->codeSize){
+        bus->memArr[i].jitBlocks[j] = NULL;
+      }
+    }
+  }
+  jit->codeUsed = 0;
+}
+
+
+// ppuDiffers()
+//   whether the registers the cpu can change, and the dots the ppu has been caught up to, are different
+static int ppuDiffers(PPU* a, PPU* b){
+  return a->ctrl != b->ctrl || a->mask != b->mask || a->status != b->status || a->oamaddr != b->oamaddr ||
+         a->data != b->data || a->wregister != b->wregister || a->xregister != b->xregister ||
+         a->vregister.vreg != b->vregister.vreg || a->tregister.vreg != b->tregister.vreg ||
+         a->dotx != b->dotx || a->scanLine != b->scanLine;
+}
+
+// checkBlock()
+//   runs a block, then rewinds the cpu and ram and runs the same instructions through the interpreter,
+//   and reports any difference between the two. the interpreter's results are the ones kept.
+//   the bus and ppu registers are rewound as well, so that the interpreter sees the same bank switches
+//   and ppu state the block did. the ppu's registers, palette, oam and vram are compared too
+static int checkBlock(CPU* cpu, Bus* bus, JitBlock block, int budget){
+  Jit* jit = bus->jit;
+  CPU before = *cpu;
+  CPU after;
+  Bus busBefore = *bus;
+  PPU ppuBefore;
+  PPU ppuAfter;
+  uint8_t paletteBefore[32];
+  uint8_t paletteAfter[32];
+  uint8_t oamBefore[256];
+  uint8_t oamAfter[256];
+  PPUBus* ppuBus = NULL;
+  int blockCycles;
+  int cycles = 0;
+  int ramDiffers = 0;
+  int ppuDiffer = 0;
+
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    if(jit->ramBefore[i] != NULL){
+      memcpy(jit->ramBefore[i], bus->memArr[i].contents, bus->memArr[i].size);
+    }
+  }
+
+  // translated blocks can write to the ppu as well (see aot.c), so its memory is rewound along with its registers
+  if(bus->ppu != NULL){
+    ppuBefore = *bus->ppu;
+    ppuBus = bus->ppu->ppubus;
+    memcpy(paletteBefore, bus->ppu->paletteram, 32);
+    memcpy(oamBefore, bus->ppu->oam, 256);
+    if(jit->vramBefore == NULL){
+      jit->numOfVramBlocks = ppuBus->numOfBlocks;
+      jit->vramBefore = calloc(ppuBus->numOfBlocks, sizeof(uint8_t*));
+      jit->vramAfter = calloc(ppuBus->numOfBlocks, sizeof(uint8_t*));
+      for(int i = 0; i < ppuBus->numOfBlocks; ++i){
+        if(ppuBus->memArr[i].type == Ram && ppuBus->memArr[i].contents != NULL){
+          jit->vramBefore[i] = malloc(ppuBus->memArr[i].size);
+          jit->vramAfter[i] = malloc(ppuBus->memArr[i].size);
+        }
+      }
+    }
+    for(int i = 0; i < ppuBus->numOfBlocks; ++i){
+      if(jit->vramBefore[i] != NULL){
+        memcpy(jit->vramBefore[i], ppuBus->memArr[i].contents, ppuBus->memArr[i].size);
+      }
+    }
+  }
+
+  blockCycles = block(cpu, bus, budget);
+  after = *cpu;
+  *bus = busBefore;
+  if(bus->ppu != NULL){
+    ppuAfter = *bus->ppu;
+    memcpy(paletteAfter, bus->ppu->paletteram, 32);
+    memcpy(oamAfter, bus->ppu->oam, 256);
+    *bus->ppu = ppuBefore;
+    memcpy(bus->ppu->paletteram, paletteBefore, 32);
+    memcpy(bus->ppu->oam, oamBefore, 256);
+    for(int i = 0; i < ppuBus->numOfBlocks; ++i){
+      if(jit->vramBefore[i] != NULL){
+        memcpy(jit->vramAfter[i], ppuBus->memArr[i].contents, ppuBus->memArr[i].size);
+        memcpy(ppuBus->memArr[i].contents, jit->vramBefore[i], ppuBus->memArr[i].size);
+        if(ppuBus->memArr[i].chrTileDirty != NULL){
+          memset(ppuBus->memArr[i].chrTileDirty, 1, ppuBus->memArr[i].size / 16);
+        }
+      }
+    }
+  }
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    if(jit->ramBefore[i] != NULL){
+      memcpy(jit->ramAfter[i], bus->memArr[i].contents, bus->memArr[i].size);
+      memcpy(bus->memArr[i].contents, jit->ramBefore[i], bus->memArr[i].size);
+    }
+  }
+
+  // cpu->cycles is kept up to date in the same way as jitExecute(), for blocks that touch the ppu (see aot.c)
+  *cpu = before;
+  while(cycles < blockCycles){
+    cpu->cycles = before.cycles + cycles;
+    cycles += interpretInstruction(cpu, bus, budget);
+  }
+
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    if(jit->ramBefore[i] != NULL && memcmp(jit->ramAfter[i], bus->memArr[i].contents, bus->memArr[i].size) != 0){
+      ramDiffers = 1;
+    }
+  }
+  if(bus->ppu != NULL){
+    ppuDiffer = ppuDiffers(&ppuAfter, bus->ppu) || memcmp(paletteAfter, bus->ppu->paletteram, 32) != 0 ||
+                memcmp(oamAfter, bus->ppu->oam, 256) != 0;
+    for(int i = 0; i < ppuBus->numOfBlocks; ++i){
+      if(jit->vramAfter[i] != NULL && memcmp(jit->vramAfter[i], ppuBus->memArr[i].contents, ppuBus->memArr[i].size) != 0){
+        ppuDiffer = 1;
+      }
+    }
+  }
+
+  if(cycles != blockCycles || cpu->a != after.a || cpu->x != after.x || cpu->y != after.y ||
+     cpu->sp != after.sp || cpu->pc != after.pc || getStatus(cpu) != getStatus(&after) || ramDiffers || ppuDiffer){
+    jit->checkFailures++;
+    printf("jit: block at %x differs from the interpreter \n", before.pc);
+    printf("  jit:         a %x x %x y %x sp %x pc %x pf %x cycles %d \n", after.a, after.x, after.y, after.sp, after.pc, getStatus(&after), blockCycles);
+    printf("  interpreter: a %x x %x y %x sp %x pc %x pf %x cycles %d ram %s ppu %s \n", cpu->a, cpu->x, cpu->y, cpu->sp, cpu->pc, getStatus(cpu), cycles,
+           ramDiffers ? "differs" : "same", ppuDiffer ? "differs" : "same");
+  }
+
+  return cycles;
+}
+
+
+// jitExecute()
+//   runs instructions until at least budget cycles have been taken, the same as calling decodeAndExecute() in a
+//   loop until then. PRG-ROM code goes through compiled (or translated) blocks, everything else through the interpreter.
+//   cpu->cycles is kept at the cycles taken so far, so the ppu can be caught up part way through (see tickPpu()).
+//   returns how many cycles have been executed
+int jitExecute(CPU* cpu, Bus* bus, int budget){
+  JitBlock* page;
+  JitBlock* entry;
+  int cycles = 0;
+
+  while(cycles < budget){
+    cpu->cycles = cycles;
+    page = bus->jitPages[cpu->pc >> 8];
+    if(page == NULL || cpu->haltFlag != 0){
+      cycles += interpretInstruction(cpu, bus, budget - cycles);
+      continue;
+    }
+
+    entry = &page[cpu->pc & 0xff];
+    if(*entry == NULL){
+#if JIT_SUPPORTED == 1
+      *entry = bus->jit->code != NULL ? compileBlock(cpu, bus, entry) : interpretInstruction;
+#else
+      *entry = interpretInstruction;
+#endif
+    }
+
+    if(bus->jit->check == 1 && *entry != interpretInstruction){
+      cycles += checkBlock(cpu, bus, *entry, budget - cycles);
+    } else {
+      cycles += (*entry)(cpu, bus, budget - cycles);
+    }
+  }
+
+  return cycles;
+}
@@ -0,0 +1,70 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+#pragma once
+#include <stdint.h>
+#include "cpu.h"
+#include "memory.h"
+
+// jit.h
+//   a small jit that compiles blocks of PRG-ROM code into x86-64 machine code.
+//   only supported on x86-64 linux, everywhere else initJit() fails and the interpreter is used
+
+
+// JIT_MAX_INSTRUCTIONS
+//   the most instructions that get compiled into a single block
+#define JIT_MAX_INSTRUCTIONS 64
+
+// JIT_CODE_SIZE
+//   size of the buffer the compiled code goes into. all blocks get thrown away once it fills up
+#define JIT_CODE_SIZE (8 * 1024 * 1024)
+
+
+struct _Jit {
+  // NULL if nothing gets compiled, see initJitBlocks()
+  uint8_t* code;
+  int codeSize;
+  int codeUsed;
+
+  // set to run every block against the interpreter as well, see jitExecute()
+  int check;
+
+  // copies of every ram block, used by check
+  uint8_t** ramBefore;
+  uint8_t** ramAfter;
+
+  // copies of every ram block on the ppu's bus (nametables and CHR-RAM), used by check
+  uint8_t** vramBefore;
+  uint8_t** vramAfter;
+  int numOfVramBlocks;
+
+  int blocksCompiled;
+  int checkFailures;
+};
+
+
+void initJitBlocks(Bus*, int);
+int initJit(Bus*, int);
+void freeJit(Bus*);
+void flushJit(Bus*);
+int jitExecute(CPU*, Bus*, int);
@@ -21,10 +21,12 @@
 */
 
 
+#ifndef ERNES_HEADLESS
 #include <SDL2/SDL_events.h>
 #include <SDL2/SDL_keycode.h>
 #include <SDL2/SDL_render.h>
 #include <SDL2/SDL_video.h>
+#endif
 #include <stdint.h>
 #include <bits/getopt_core.h>
 #include <linux/limits.h>
@@ -34,24 +36,29 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <cjson/cJSON.h>
+#include <getopt.h>
+#include <time.h>
 #include <dirent.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include "cpu.h"
 #include "memory.h"
 #include "ppu.h"
+#ifndef ERNES_HEADLESS
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_timer.h>
+#endif
 #include "general.h"
+#include "jit.h"
+#include "aot.h"
+#include "testvectors.h"
+#include "compositor.h"
 
 #define MAX_STR 128
 
 // original resolution of Nintendo
 
-// this includes the hblanking period as well
-#define CPU_CYCLES_PER_SCANLINE 114
-
 void parseTwoHexNums(char*, uint16_t*, uint16_t*);
 
 void printHelp();
@@ -93,6 +100,9 @@ typedef struct _tr {
   processorState json;
   int passFlag;
 
+  // hash of the cpu state, cycles and ram after every test in the file, only set by jsonStateHash()
+  uint64_t stateHash;
+
 
 
 
@@ -103,16 +113,57 @@ typedef struct _tr {
 // pthread_create that only accepts void* as arguments
 typedef struct aft {
 
+  // every thread gets its own bus to run the tests on
   Bus* bus;
-  char file[MAX_STR];
-  uint8_t opcodeToTest;
+
+  // files are shared between all of the threads, nextFile is the next one that hasn't been taken yet
+  char** files;
+  int numOfFiles;
+  int* nextFile;
+  pthread_mutex_t* lock;
+
+  // one per file
   TestResults* testResults;
 
+  // 1 to hash the outcome of the tests with jsonStateHash() instead of checking them against the json
+  int hashFlag;
+
 } ArgsForThreads;
 
-TestResults* jsonTesterParallel(char**, Bus*, int, int);
-void startNes(char*, int);
-void nesMainLoop(Bus*, SDL_Renderer*, SDL_Texture*, int);
+int jsonStateHash(char*, Bus*, uint64_t*);
+TestResults* jsonTesterParallel(char**, Bus*, int, int, int);
+
+// options for running the emulator without SDL (--headless)
+typedef struct ho {
+
+  // number of frames to run, 0 for no limit
+  long frames;
+
+  // stop once the byte at untilAddr is equal (or not equal if untilNotEqual is 1) to untilValue.
+  // checked at the end of every frame
+  int untilFlag;
+  int untilNotEqual;
+  uint16_t untilAddr;
+  uint8_t untilValue;
+
+  // prints an FNV-1a hash of the final frame
+  int hashFlag;
+
+  // writes the final frame to this file as a .ppm if not empty
+  char dumpFile[MAX_STR];
+
+} HeadlessOptions;
+
+int parseUntil(char*, HeadlessOptions*);
+void startNes(char*, int, int, int, int, int, char*, HeadlessOptions*);
+void initCpuBackend(Bus*, int, int, int);
+int runScanline(Bus*);
+#ifndef ERNES_HEADLESS
+void nesMainLoop(Bus*, SDL_Renderer*, SDL_Texture*, int, int);
+#endif
+int headlessLoop(Bus*, HeadlessOptions*);
+uint64_t hashFrameBuffer(PPU*);
+int dumpFrameBuffer(PPU*, char*);
 void freeAndExit(Bus*);
 
 
@@ -139,6 +190,19 @@ int main(int argc, char* argv[]){
   int nFlag = 0;
   int iFlag = 0;
   int sFlag = 0;
+  int dFlag = 0;
+  int jitFlag = 0;
+  int aotFlag = 0;
+  char* translateFile = NULL;
+  int pFlag = 0;
+  int cFlag = 0;
+  int bFlag = 0;
+  int headlessFlag = 0;
+  int compositor = COMPOSITOR_AUTO;
+  int checkCompositorFlag = 0;
+  int checkFusedFlag = 0;
+  int frameSkip = 0;
+  HeadlessOptions headless;
   int opt;
   int jFlag = 0;
   char fileDirectory[MAX_STR];
@@ -151,9 +215,28 @@ int main(int argc, char* argv[]){
   FILE* fptr;
   printf("    nesemu  Copyright (C) 2026  Cameron Kelly \n This program comes with ABSOLUTELY NO WARRANTY; for details type `show w'. \n This is free software, and you are welcome to redistribute it \n under certain conditions; type `show c' for details. \n");
 
+  // long options, mostly used with -n
+  static struct option longOptions[] = {
+    {"headless", no_argument, NULL, 'H'},
+    {"frames", required_argument, NULL, 'F'},
+    {"until", required_argument, NULL, 'U'},
+    {"hash", no_argument, NULL, 'X'},
+    {"dump", required_argument, NULL, 'D'},
+    {"compositor", required_argument, NULL, 'C'},
+    {"check-compositor", no_argument, NULL, 'K'},
+    {"check-fused", no_argument, NULL, 'G'},
+    {"frameskip", required_argument, NULL, 'S'},
+    {"aot", no_argument, NULL, 'A'},
+    {"translate", required_argument, NULL, 'T'},
+    {NULL, 0, NULL, 0}
+  };
+
+  memset(&headless, 0, sizeof(HeadlessOptions));
+  headless.frames = 600;
+
   // parsing command line arguments
   if(argc > 1){
-    while((opt = getopt(argc, argv, "fjhnis")) != -1)
+    while((opt = getopt_long(argc, argv, "fjhnisdJkApcb", longOptions, NULL)) != -1)
     {
       switch(opt){
         case 'f':
@@ -188,6 +271,92 @@ int main(int argc, char* argv[]){
             strcpy(screenScaling, argv[optind]);
           }
           break;
+        case 'd':
+          // runs the cpu through the decode cache
+          dFlag = 1;
+          break;
+        case 'J':
+          // runs the cpu through the jit
+          jitFlag = 1;
+          break;
+        case 'k':
+          // runs the cpu through the jit, checking every block against the interpreter
+          jitFlag = 2;
+          break;
+        case 'A':
+          // runs the cpu through the blocks translated ahead of time with --translate
+          aotFlag = 1;
+          break;
+        case 'T':
+          // translates the rom's PRG-ROM into c, then exits
+          translateFile = optarg;
+          break;
+        case 'p':
+          // runs every json test in a directory, across all cores
+          pFlag = 1;
+          if(argv[optind] != NULL){
+            strcpy(fileDirectory, argv[optind]);
+          }
+          break;
+        case 'c':
+          // runs every json test in a directory one file at a time, then across all cores, and compares the two
+          cFlag = 1;
+          if(argv[optind] != NULL){
+            strcpy(fileDirectory, argv[optind]);
+          }
+          break;
+        case 'b':
+          // converts every json test in a directory into the binary format
+          bFlag = 1;
+          if(argv[optind] != NULL){
+            strcpy(fileDirectory, argv[optind]);
+          }
+          break;
+        case 'H':
+          // runs the rom without SDL
+          headlessFlag = 1;
+          break;
+        case 'F':
+          headless.frames = strtol(optarg, NULL, 10);
+          break;
+        case 'U':
+          // ADDR=VALUE or ADDR!=VALUE, both in hex
+          if(parseUntil(optarg, &headless) == 0){
+            printf("--until expects ADDR=VALUE or ADDR!=VALUE in hex \n");
+            exit(1);
+          }
+          break;
+        case 'X':
+          headless.hashFlag = 1;
+          break;
+        case 'D':
+          strncpy(headless.dumpFile, optarg, MAX_STR - 1);
+          break;
+        case 'C':
+          // forces a compositor, so they can be compared against each other
+          if(strcmp(optarg, "scalar") == 0){
+            compositor = COMPOSITOR_SCALAR;
+          } else if(strcmp(optarg, "sse2") == 0){
+            compositor = COMPOSITOR_SSE2;
+          } else if(strcmp(optarg, "avx2") == 0){
+            compositor = COMPOSITOR_AVX2;
+          } else {
+            printf("--compositor expects scalar, sse2 or avx2 \n");
+            exit(1);
+          }
+          break;
+        case 'K':
+          checkCompositorFlag = 1;
+          break;
+        case 'G':
+          checkFusedFlag = 1;
+          break;
+        case 'S':
+          frameSkip = atoi(optarg);
+          if(frameSkip < 0){
+            frameSkip = 0;
+          }
+          break;
           
       }
     } 
@@ -200,12 +369,31 @@ int main(int argc, char* argv[]){
   }
 
   
+  // checks the SIMD compositors against the scalar one
+  if(checkCompositorFlag == 1){
+    int numOfMismatches = checkCompositors(2000);
+
+    printf("%d mismatches between the compositors \n", numOfMismatches);
+    exit(numOfMismatches == 0 ? 0 : 1);
+  }
+
+  // checks the decode cache's fused idioms against running the same code one instruction at a time
+  if(checkFusedFlag == 1){
+    int numOfMismatches = checkFusedOps(300, 3000);
+
+    printf("%d mismatches between executeCached() and decodeAndExecute() \n", numOfMismatches);
+    exit(numOfMismatches == 0 ? 0 : 1);
+  }
+
   // start Tom Harte's tester
   if(jFlag == 1){
     Bus bus;
     initBus(&bus, 1);
     initMemStruct(&(bus.memArr[0]), 0xffff, Ram, TRUE);
     mapMemory(&bus, 0, 0x0000);
+    if(dFlag == 1){
+      enableDecodeCache(&bus);
+    }
     printf("Entering Json Mode \n");
     if(jsonTester(file, &bus, NULL) == 1){
       printf("Passed all tests! \n");  
@@ -215,6 +403,132 @@ int main(int argc, char* argv[]){
 
   
   }
+
+  // converts all of Tom Harte's tests in a directory into the binary format, next to the json files
+  if(bFlag == 1){
+    char jsonFile[MAX_STR * 2];
+    char binFile[MAX_STR * 2];
+    struct stat fileStat;
+    int numConverted = 0;
+
+    for(int i = 0; i < 256; ++i){
+      snprintf(jsonFile, MAX_STR * 2, "%s/%02x.json", fileDirectory, i);
+      snprintf(binFile, MAX_STR * 2, "%s/%02x.bin", fileDirectory, i);
+      if(stat(jsonFile, &fileStat) != 0){
+        continue;
+      }
+      if(convertJsonTests(jsonFile, binFile) == 1){
+        numConverted++;
+      }
+    }
+    printf("Converted %d json tests \n", numConverted);
+    exit(numConverted > 0 ? 0 : 1);
+  }
+
+  // runs all of Tom Harte's tests in a directory
+  if(pFlag == 1 || cFlag == 1){
+    char* files[256];
+    int numOfFiles = 0;
+    int numOfThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    int numPassed = 0;
+    struct stat fileStat;
+    Bus* buses;
+    TestResults* testResults;
+
+    // uses the binary version of a test if it's been made with -b
+    for(int i = 0; i < 256; ++i){
+      files[numOfFiles] = malloc(MAX_STR * 2);
+      snprintf(files[numOfFiles], MAX_STR * 2, "%s/%02x.bin", fileDirectory, i);
+      if(stat(files[numOfFiles], &fileStat) == 0){
+        numOfFiles++;
+        continue;
+      }
+      snprintf(files[numOfFiles], MAX_STR * 2, "%s/%02x.json", fileDirectory, i);
+      if(stat(files[numOfFiles], &fileStat) == 0){
+        numOfFiles++;
+      } else {
+        free(files[numOfFiles]);
+      }
+    }
+    if(numOfFiles == 0){
+      printf("No json tests found in %s \n", fileDirectory);
+      exit(1);
+    }
+    if(numOfThreads < 1){
+      numOfThreads = 1;
+    }
+    // the point of -c is to have cpus running at the same time, even on a single core
+    if(cFlag == 1 && numOfThreads < 2){
+      numOfThreads = 2;
+    }
+    if(numOfThreads > numOfFiles){
+      numOfThreads = numOfFiles;
+    }
+
+    buses = calloc(numOfThreads, sizeof(Bus));
+    for(int i = 0; i < numOfThreads; ++i){
+      initBus(&buses[i], 1);
+      initMemStruct(&(buses[i].memArr[0]), 0xffff, Ram, TRUE);
+      mapMemory(&buses[i], 0, 0x0000);
+      if(dFlag == 1){
+        enableDecodeCache(&buses[i]);
+      }
+    }
+
+    // checks that cpus running on separate threads don't affect each other, by comparing the outcome
+    // of every test against running them one at a time on a single thread
+    if(cFlag == 1){
+      uint64_t* serialHashes = calloc(numOfFiles, sizeof(uint64_t));
+      int numOfMismatches = 0;
+
+      printf("Running %d json tests on 1 thread \n", numOfFiles);
+      for(int i = 0; i < numOfFiles; ++i){
+        if(jsonStateHash(files[i], &buses[0], &serialHashes[i]) != 1){
+          printf("%s: could not be run \n", files[i]);
+          exit(1);
+        }
+      }
+
+      printf("Running %d json tests on %d threads \n", numOfFiles, numOfThreads);
+      testResults = jsonTesterParallel(files, buses, numOfFiles, numOfThreads, 1);
+
+      for(int i = 0; i < numOfFiles; ++i){
+        if(testResults[i].passFlag != 1){
+          printf("%s: could not be run \n", testResults[i].name);
+          numOfMismatches++;
+        } else if(testResults[i].stateHash != serialHashes[i]){
+          printf("%s: differs between 1 and %d threads (%016llx, %016llx) \n", testResults[i].name, numOfThreads,
+                 (unsigned long long)serialHashes[i], (unsigned long long)testResults[i].stateHash);
+          numOfMismatches++;
+        }
+      }
+      printf("%d of %d files gave the same results on %d threads \n", numOfFiles - numOfMismatches, numOfFiles, numOfThreads);
+
+      exit(numOfMismatches == 0 ? 0 : 1);
+    }
+
+    printf("Running %d json tests on %d threads \n", numOfFiles, numOfThreads);
+    testResults = jsonTesterParallel(files, buses, numOfFiles, numOfThreads, 0);
+
+    for(int i = 0; i < numOfFiles; ++i){
+      if(testResults[i].passFlag == 1){
+        numPassed++;
+        continue;
+      }
+      if(testResults[i].passFlag == -1){
+        printf("%s: could not be run \n", testResults[i].name);
+        continue;
+      }
+      printf("%s: failed (opcode %02x) \n", testResults[i].name, testResults[i].instruction);
+      printf("  cpu:  a %02x x %02x y %02x p %02x s %02x pc %04x \n", testResults[i].state.a, testResults[i].state.x,
+             testResults[i].state.y, testResults[i].state.p, testResults[i].state.s, testResults[i].state.pc);
+      printf("  json: a %02x x %02x y %02x p %02x s %02x pc %04x \n", testResults[i].json.a, testResults[i].json.x,
+             testResults[i].json.y, testResults[i].json.p, testResults[i].json.s, testResults[i].json.pc);
+    }
+    printf("%d of %d opcodes passed \n", numPassed, numOfFiles);
+
+    exit(numPassed == numOfFiles ? 0 : 1);
+  }
       
  
 
@@ -261,7 +575,8 @@ int main(int argc, char* argv[]){
   } 
 
   if(nFlag == 1){
-    startNes(file, atoi(screenScaling));
+    printf("compositor: %s \n", compositorName(initCompositor(compositor)));
+    startNes(file, atoi(screenScaling), dFlag, jitFlag, aotFlag, frameSkip, translateFile, headlessFlag == 1 ? &headless : NULL);
   }
   
   // starts interpreter with no file
@@ -302,6 +617,41 @@ void parseTwoHexNums(char* input, uint16_t* start, uint16_t* end){
 
 }
 
+// parseUntil()
+//   parses the argument of --until (ADDR=VALUE or ADDR!=VALUE, both in hex) into options.
+//   returns 1 on success, 0 if the argument is malformed
+int parseUntil(char* input, HeadlessOptions* options){
+  char* end;
+  long addr;
+  long value;
+
+  addr = strtol(input, &end, 16);
+  if(end == input || addr < 0 || addr > 0xffff){
+    return 0;
+  }
+
+  if(end[0] == '!' && end[1] == '='){
+    options->untilNotEqual = 1;
+    end += 2;
+  } else if(end[0] == '='){
+    options->untilNotEqual = 0;
+    end += 1;
+  } else {
+    return 0;
+  }
+
+  input = end;
+  value = strtol(input, &end, 16);
+  if(end == input || *end != '\0' || value < 0 || value > 0xff){
+    return 0;
+  }
+
+  options->untilFlag = 1;
+  options->untilAddr = (uint16_t)addr;
+  options->untilValue = (uint8_t)value;
+  return 1;
+}
+
 
 
 
@@ -397,7 +747,7 @@ void interpreter(Bus* bus){
       printf("y: %x \n", bus->cpu->y);
       printf("a: %x \n", bus->cpu->a);
       printf("sp: %x \n", bus->cpu->sp);
-      printf("pf: %x \n", bus->cpu->pf);
+      printf("pf: %x \n", getStatus(bus->cpu));
       printf("pc: %x \n", bus->cpu->pc);
       
     } else {
@@ -412,7 +762,14 @@ void interpreter(Bus* bus){
 
 }
 
-void startNes(char* romPath, int screenScaling){
+// startNes()
+//   loads the rom and runs it. if decodeCache is 1, the cpu is run through the decode cache.
+//   jit is 0 for no jit, 1 for the jit and 2 for the jit with every block checked against the interpreter
+//   if aot is 1, the blocks built in with make AOT=FILE are used (see aot.c)
+//   frameSkip is the number of frames that aren't drawn for every one that is (see nesMainLoop())
+//   if translateFile isn't NULL, the PRG-ROM is translated into c and written to it instead of being run
+//   if headless isn't NULL, the rom is run with headlessLoop() instead of in an SDL window
+void startNes(char* romPath, int screenScaling, int decodeCache, int jit, int aot, int frameSkip, char* translateFile, HeadlessOptions* headless){
   printf("Starting NES emulator \n");
 
   FILE* romPtr; 
@@ -436,12 +793,18 @@ void startNes(char* romPath, int screenScaling){
     screenScaling = 1;
   }
 
-  SDL_Window* win = SDL_CreateWindow("erNES", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH * screenScaling, WINDOW_HEIGHT * screenScaling, 0);
+#ifndef ERNES_HEADLESS
+  SDL_Window* win;
   SDL_Renderer *renderer;
   SDL_Texture *texture;
+#else
+  // built with make HEADLESS=1, there's no SDL to open a window with
+  if(headless == NULL && translateFile == NULL){
+    printf("built without SDL (make HEADLESS=1), only --headless can be used \n");
+    exit(1);
+  }
+#endif
 
-  renderer = SDL_CreateRenderer(win, 1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, WINDOW_WIDTH, WINDOW_HEIGHT);
   romPtr = fopen(romPath, "r");
 
 
@@ -569,10 +932,11 @@ void startNes(char* romPath, int screenScaling){
 
       }
       
+      initCpuBackend(&bus, decodeCache, jit, aot);
       reset(bus.cpu, &bus);
       resetPpu(bus.ppu, 1);
-
       bus.ppu->mapper = bus.mapper;
+
       if(numOfChrRoms == 0){
         bus.ppu->flagChrRam = 1;
       } else {
@@ -580,16 +944,6 @@ void startNes(char* romPath, int screenScaling){
       }
 
       bus.ppu->mirroring = mirroring;
-
-      if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printf("error initializing SDL: %s\n", SDL_GetError());
-      }
-
-      SDL_RenderClear(renderer);
-      SDL_RenderPresent(renderer);
-      printf("SDL initialized! \n");
- 
-      nesMainLoop(&bus, renderer, texture, screenScaling);
       break;
     
 
@@ -676,25 +1030,12 @@ void startNes(char* romPath, int screenScaling){
         }
 
       }
+      initCpuBackend(&bus, decodeCache, jit, aot);
       reset(bus.cpu, &bus);
       resetPpu(bus.ppu, 1);
       bus.ppu->mapper = bus.mapper;
 
-
-
-      if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printf("error initializing SDL: %s\n", SDL_GetError());
-      }
-
-      SDL_RenderClear(renderer);
-      SDL_RenderPresent(renderer);
-      printf("SDL initialized! \n");
-  
       bus.ppu->mirroring = mirroring;
-
-      // once machine has been setup to the mapper's needs, enter main loop
-      nesMainLoop(&bus, renderer, texture, screenScaling);
-
       break;
     case 2:
       printf("mapper 2 \n");
@@ -732,25 +1073,12 @@ void startNes(char* romPath, int screenScaling){
         bus.ppu->ppubus->memArr[0].contents[i] = fgetc(romPtr);
 
       }
+      initCpuBackend(&bus, decodeCache, jit, aot);
       reset(bus.cpu, &bus);
       resetPpu(bus.ppu, 1);
       bus.ppu->mapper = bus.mapper;
 
-
-
-      if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printf("error initializing SDL: %s\n", SDL_GetError());
-      }
-
-      SDL_RenderClear(renderer);
-      SDL_RenderPresent(renderer);
-      printf("SDL initialized! \n");
-  
       bus.ppu->mirroring = mirroring;
-
-      // once machine has been setup to the mapper's needs, enter main loop
-      nesMainLoop(&bus, renderer, texture, screenScaling);
-
       break;
     case 3:
       printf("mapper 3 \n");
@@ -781,25 +1109,12 @@ void startNes(char* romPath, int screenScaling){
         }
       }
 
+      initCpuBackend(&bus, decodeCache, jit, aot);
       reset(bus.cpu, &bus);
       resetPpu(bus.ppu, 1);
       bus.ppu->mapper = bus.mapper;
 
-
-
-      if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printf("error initializing SDL: %s\n", SDL_GetError());
-      }
-
-      SDL_RenderClear(renderer);
-      SDL_RenderPresent(renderer);
-      printf("SDL initialized! \n");
-  
       bus.ppu->mirroring = mirroring;
-
-      // once machine has been setup to the mapper's needs, enter main loop
-      nesMainLoop(&bus, renderer, texture, screenScaling);
-
       break;
     case 7:
       printf("numofprgroms %x \n", numOfPrgRoms);
@@ -828,21 +1143,12 @@ void startNes(char* romPath, int screenScaling){
           }
         }
       }
+      initCpuBackend(&bus, decodeCache, jit, aot);
       reset(bus.cpu, &bus);
       resetPpu(bus.ppu, 1);
       bus.ppu->mapper = bus.mapper;
 
-      if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printf("error initializing SDL: %s\n", SDL_GetError());
-      }
-
-      SDL_RenderClear(renderer);
-      SDL_RenderPresent(renderer);
-      printf("SDL initialized! \n");
-  
       bus.ppu->mirroring = mirroring;
-      nesMainLoop(&bus, renderer, texture, screenScaling);
-
       break;
     default:
       printf("mapper is not compatible \nincompatible rom \n");
@@ -851,10 +1157,43 @@ void startNes(char* romPath, int screenScaling){
 
   }
 
+  fclose(romPtr);
+
+  if(translateFile != NULL){
+    exit(aotTranslate(&bus, translateFile) == 1 ? 0 : 1);
+  }
+
+  // every mapper has loaded its CHR by now
+  initChrCache(bus.ppu);
+  initScheduler(&bus.scheduler);
+
+  if(headless != NULL){
+    // no window, renderer or texture, SDL is never touched
+    headlessLoop(&bus, headless);
+    freeAndExit(&bus);
+  }
+
+#ifndef ERNES_HEADLESS
+  if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+    printf("error initializing SDL: %s\n", SDL_GetError());
+  }
+
+  win = SDL_CreateWindow("erNES", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH * screenScaling, WINDOW_HEIGHT * screenScaling, 0);
+  renderer = SDL_CreateRenderer(win, 1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+  SDL_RenderClear(renderer);
+  SDL_RenderPresent(renderer);
+  printf("SDL initialized! \n");
+
+  // once machine has been setup to the mapper's needs, enter main loop
+  nesMainLoop(&bus, renderer, texture, screenScaling, frameSkip);
+
 
   
     SDL_Quit();
     freeAndExit(&bus);
+#endif
     
     return;
   
@@ -862,12 +1201,109 @@ void startNes(char* romPath, int screenScaling){
 
 }
 
+// initCpuBackend()
+//   sets up the decode cache, the jit and/or the blocks translated ahead of time once the rom has been loaded into memory.
+//   falls back to the interpreter if the jit can't be used
+void initCpuBackend(Bus* bus, int decodeCache, int jit, int aot){
+  updatePageTable(bus);
+  if(decodeCache == 1){
+    enableDecodeCache(bus);
+  }
+  if(jit != 0){
+    if(initJit(bus, jit == 2 ? 1 : 0) == 0){
+      printf("jit: falling back to the interpreter \n");
+    }
+  }
+  if(aot == 1){
+    if(initAot(bus, jit == 2 ? 1 : 0) == 0){
+      printf("aot: falling back to the %s \n", bus->jit != NULL ? "jit" : "interpreter");
+    }
+  }
+}
+
+
+// runScanline()
+//   runs the cpu up to the next scheduled event and handles every event that is due, until the end of a scanline.
+//   the end of each scanline renders whatever the ppu hasn't caught up on yet, and the events at the end of scanlines 240, 260 and 261 start vblank,
+//   end it and run the prerender scanline (see scheduler.h).
+//   returns the scanline that was just run
+int runScanline(Bus* bus){
+  Scheduler* scheduler = &bus->scheduler;
+  int currCycles;
+  int cycleBudget;
+  int scanLine = -1;
+  int event;
+  uint64_t eventTime;
+
+  while(scanLine == -1){
+    // instructions are run in one go up to the next event. the last one can run over it, which is carried
+    // over by the clock instead of being dropped. the ppu is only caught up in between when the cpu touches
+    // its registers (see tickPpu())
+    while(scheduler->clock < scheduler->nextEventTime){
+      cycleBudget = (scheduler->nextEventTime - scheduler->clock + MASTER_CYCLES_PER_CPU_CYCLE - 1) / MASTER_CYCLES_PER_CPU_CYCLE;
+      if(bus->jit != NULL){
+        currCycles = jitExecute(bus->cpu, bus, cycleBudget);
+        bus->cpu->cycles = 0;
+      } else if(bus->decodeCache == 1){
+        currCycles = executeCached(bus->cpu, bus, cycleBudget);
+        bus->cpu->cycles = 0;
+      } else {
+        currCycles = execute(bus->cpu, bus, cycleBudget);
+        bus->cpu->cycles = 0;
+      }
+      scheduler->clock += (uint64_t)currCycles * MASTER_CYCLES_PER_CPU_CYCLE;
+    }
+
+    while((event = popEvent(scheduler, &eventTime)) != -1){
+      switch(event){
+        case EVENT_SCANLINE:
+          // finish the scanline, nothing is drawn while in vblank and during the prerender scanline (261)
+          renderScanline(bus->ppu);
+          bus->ppu->lineStart = eventTime;
+
+          scanLine = bus->ppu->scanLine;
+          bus->ppu->scanLine++;
+          bus->ppu->scanLineSprites++;
+
+          if(bus->ppu->scanLine == SCANLINES_PER_FRAME){
+            bus->ppu->scanLine = 0;
+            bus->ppu->scanLineSprites = -1;
+          }
+          scheduleEvent(scheduler, EVENT_SCANLINE, eventTime + MASTER_CYCLES_PER_SCANLINE);
+          break;
+        case EVENT_VBLANK_START:
+          vblankStart(bus);
+          scheduleEvent(scheduler, EVENT_VBLANK_START, eventTime + MASTER_CYCLES_PER_FRAME);
+          break;
+        case EVENT_VBLANK_END:
+          vblankEnd(bus);
+          scheduleEvent(scheduler, EVENT_VBLANK_END, eventTime + MASTER_CYCLES_PER_FRAME);
+          break;
+        case EVENT_PRERENDER:
+          prerenderScanline(bus);
+          bus->ppu->frames++;
+          scheduleEvent(scheduler, EVENT_PRERENDER, eventTime + MASTER_CYCLES_PER_FRAME);
+          break;
+        case EVENT_MAPPER_IRQ:
+          // the mapper schedules the next one itself
+          irq(bus->cpu, bus);
+          break;
+      }
+    }
+  }
+
+  return scanLine;
+}
+
+
+#ifndef ERNES_HEADLESS
 // nesMainLoop()
-//   decodes and executes 1 scanline worth of instructions, then instructs ppu to render the scanline
-//   once a 240 scanlines have been rendered, draw framebuffer to SDL and enable a vblank
-void nesMainLoop(Bus* bus, SDL_Renderer* renderer, SDL_Texture* texture, int screenScaling){
-      uint8_t oppCode;
-      int mirroring = bus->ppu->mirroring;
+//   runs the emulator one scanline at a time with runScanline()
+//   once a 240 scanlines have been rendered, draw framebuffer to SDL. after the prerender scanline,
+//   waits for the next frame and polls for input
+//   with frameSkip, the frameSkip frames before every drawn frame are run with ppu->skipFrame set and
+//   without waiting, so the game runs frameSkip + 1 times as fast
+void nesMainLoop(Bus* bus, SDL_Renderer* renderer, SDL_Texture* texture, int screenScaling, int frameSkip){
       SDL_Event event;
       uint64_t freq = SDL_GetPerformanceFrequency();
       uint64_t frame_start = 0;
@@ -881,78 +1317,55 @@ void nesMainLoop(Bus* bus, SDL_Renderer* renderer, SDL_Texture* texture, int scr
       const double target_frame_time = 1000.0 / target_fps;
       int mouseX;
       int mouseY;
-      int currCycles;
+      int scanLine;
+      int skipCounter = 0;
+
+      bus->ppu->skipFrame = frameSkip > 0;
 
 
 
       // enter main loop
       while(1){
-      // mark time at the start of the frame being drawn
-      // TODO: implement dot based renderer
-        if(bus->cpu->cycles < CPU_CYCLES_PER_SCANLINE){
-          oppCode = readBus(bus, bus->cpu->pc);
-          currCycles = decodeAndExecute(bus->cpu, bus, oppCode);
-          bus->cpu->cycles += currCycles;
-
-
-          // TODO: implement dot based renderer
-          // for every cpu cycle, tick the PPU 3 times
-          /*
-          for(int i = 0; i < currCycles; ++i){
-            tickPpu(bus);
-            tickPpu(bus);
-            tickPpu(bus);
-          }*/
-
-
-          //printf("cycles total: %d \n", bus.cpu->cycles);
-        } else if(bus->cpu->cycles >= CPU_CYCLES_PER_SCANLINE){
-          // render a scanline except while in vblank and during the prerender scanline (261)
-
-          if(bus->ppu->vblank == 0 && bus->ppu->prerenderScanlineFlag == 0){
-            renderScanline(bus->ppu);
-          }
-
+        // mark time at the start of the frame being drawn, or the first skipped frame before it
+        if(bus->ppu->scanLine == 0 && skipCounter == 0){
+          frame_start = SDL_GetPerformanceCounter();
+        }
 
-          if(bus->ppu->scanLine == 0){
-            frame_start = SDL_GetPerformanceCounter();
+        scanLine = runScanline(bus);
 
-          }
-            
-            if(bus->ppu->scanLine == 240){
-   
-              vblankStart(bus);
+            if(scanLine == 240 && bus->ppu->skipFrame == 0){
               drawFrameBuffer(bus->ppu, renderer, texture);
  
               
               //printNameTable(bus);
-            } else if(bus->ppu->scanLine == 260){
-              vblankEnd(bus);
-
-            } else if(bus->ppu->scanLine == 261){
-              prerenderScanline(bus);
-              
+            } else if(scanLine == 261){
               // after prerenderscanline, mark the end of the frame, then delay until the next frame is drawn
-              frame_end = SDL_GetPerformanceCounter();
-              elasped_ms = (frame_end - frame_start) * 1000.0 / freq;
-              if(elasped_ms < target_frame_time){
-                SDL_Delay((uint32_t)(target_frame_time - elasped_ms));
-              }
-
-              sdlFrames++;
-              if(fps_lastTime < SDL_GetTicks() - 1000){
-                fps_lastTime = SDL_GetTicks();
-                fps_current = sdlFrames;
-                sdlFrames = 0;
-                if(fps_current != 1){
-                  printf("fps: %d \n", fps_current);
+              if(bus->ppu->skipFrame == 0){
+                frame_end = SDL_GetPerformanceCounter();
+                elasped_ms = (frame_end - frame_start) * 1000.0 / freq;
+                if(elasped_ms < target_frame_time){
+                  SDL_Delay((uint32_t)(target_frame_time - elasped_ms));
                 }
 
+                sdlFrames++;
+                if(fps_lastTime < SDL_GetTicks() - 1000){
+                  fps_lastTime = SDL_GetTicks();
+                  fps_current = sdlFrames;
+                  sdlFrames = 0;
+                  if(fps_current != 1){
+                    printf("fps: %d \n", fps_current);
+                  }
+
+                }
               }
+
+              // every frameSkip + 1th frame is drawn
+              skipCounter = (skipCounter + 1) % (frameSkip + 1);
+              bus->ppu->skipFrame = skipCounter != frameSkip;
             if(processLightGunInput >= 1 && processLightGunInput <= 2){
               printf("frame processed %d \n", bus->ppu->frames);
-              printf("%x \n", bus->ppu->frameBuffer[mouseY / screenScaling][mouseX / screenScaling]);
-              if(bus->ppu->frameBuffer[mouseY / screenScaling][mouseX / screenScaling] == 0xffffff || bus->ppu->frameBuffer[mouseY / screenScaling][mouseX / screenScaling] == 0xffc6c3){
+              printf("%x \n", bus->ppu->rgbLut[bus->ppu->frameBuffer[((mouseY / screenScaling) * WINDOW_WIDTH) + (mouseX / screenScaling)]]);
+              if(bus->ppu->rgbLut[bus->ppu->frameBuffer[((mouseY / screenScaling) * WINDOW_WIDTH) + (mouseX / screenScaling)]] == 0xffffff || bus->ppu->rgbLut[bus->ppu->frameBuffer[((mouseY / screenScaling) * WINDOW_WIDTH) + (mouseX / screenScaling)]] == 0xffc6c3){
                 bus->controller2.lightSensor = 0;
                 processLightGunInput = 0;
                 printf("detected! \n");
@@ -1042,26 +1455,105 @@ void nesMainLoop(Bus* bus, SDL_Renderer* renderer, SDL_Texture* texture, int scr
                     break;
                 }
               }
-
-              bus->ppu->frames++;
             }
+  }
+}
+#endif
+
+
+// headlessLoop()
+//   runs the emulator without SDL and without waiting between frames, until the number of frames in
+//   options have been run or the until condition is met. prints the number of frames run and how fast,
+//   and a hash of the final frame if asked to. returns 1 if the until condition was met, otherwise 0
+int headlessLoop(Bus* bus, HeadlessOptions* options){
+  struct timespec start;
+  struct timespec end;
+  double elapsed;
+  long frames = 0;
+  int conditionMet = 0;
+  uint8_t value;
+
+  printf("running headless \n");
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  while(options->frames == 0 || frames < options->frames){
+    if(runScanline(bus) != 261){
+      continue;
+    }
+    frames++;
 
-            bus->ppu->scanLine++;
-            bus->ppu->scanLineSprites++;
+    if(options->untilFlag == 1){
+      value = readBus(bus, options->untilAddr);
+      if((value == options->untilValue) != options->untilNotEqual){
+        conditionMet = 1;
+        break;
+      }
+    }
+  }
 
-            bus->cpu->cycles = 0;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  elapsed = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
 
-            if(bus->ppu->scanLine == 262){
-              bus->ppu->scanLine = 0;
-              bus->ppu->scanLineSprites = -1;
-            }
+  printf("frames: %ld \n", frames);
+  printf("time: %.3f s (%.1f fps) \n", elapsed, elapsed > 0 ? frames / elapsed : 0.0);
+  if(options->untilFlag == 1){
+    printf("until $%04x %s $%02x: %s \n", options->untilAddr, options->untilNotEqual == 1 ? "!=" : "==",
+           options->untilValue, conditionMet == 1 ? "met" : "not met");
+  }
+  if(options->hashFlag == 1){
+    printf("hash: %016llx \n", (unsigned long long)hashFrameBuffer(bus->ppu));
+  }
+  if(options->dumpFile[0] != '\0'){
+    if(dumpFrameBuffer(bus->ppu, options->dumpFile) == 1){
+      printf("frame written to %s \n", options->dumpFile);
+    } else {
+      printf("Cannot open file %s \n", options->dumpFile);
+    }
+  }
 
-        }
-        
+  return conditionMet;
+}
 
- 
-       
+
+// hashFrameBuffer()
+//   64 bit FNV-1a hash of the framebuffer's palette indices, used to check a frame against a known good one
+uint64_t hashFrameBuffer(PPU* ppu){
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for(int i = 0; i < WINDOW_HEIGHT * WINDOW_WIDTH; ++i){
+    hash ^= ppu->frameBuffer[i];
+    hash *= 0x100000001b3ULL;
   }
+
+  return hash;
+}
+
+
+// dumpFrameBuffer()
+//   writes the framebuffer to a binary .ppm (P6) file. returns 1 on success, 0 if the file can't be opened
+int dumpFrameBuffer(PPU* ppu, char* path){
+  FILE* fptr = fopen(path, "wb");
+  uint32_t* frame;
+  uint8_t rgb[3];
+
+  if(fptr == NULL){
+    return 0;
+  }
+
+  frame = malloc(sizeof(uint32_t) * WINDOW_WIDTH * WINDOW_HEIGHT);
+  convertFrameBuffer(ppu, frame, WINDOW_WIDTH * sizeof(uint32_t));
+
+  fprintf(fptr, "P6\n%d %d\n255\n", WINDOW_WIDTH, WINDOW_HEIGHT);
+  for(int i = 0; i < WINDOW_WIDTH * WINDOW_HEIGHT; ++i){
+    rgb[0] = (frame[i] >> 16) & 0xff;
+    rgb[1] = (frame[i] >> 8) & 0xff;
+    rgb[2] = frame[i] & 0xff;
+    fwrite(rgb, 1, 3, fptr);
+  }
+
+  free(frame);
+  fclose(fptr);
+  return 1;
 }
 
 
@@ -1080,16 +1572,15 @@ void dumpFileToMemory(uint8_t* fileBuffer, Mem* mem, int offset, int size){
 
 
 // helper function to populate the processorState struct
-// can send a
-void populateProcStructWithJson(cJSON* json, processorState* procStat, uint8_t opcode){
-
-  procStat->x = cJSON_GetObjectItemCaseSensitive(json, "x")->valueint;
-  procStat->y = cJSON_GetObjectItemCaseSensitive(json, "y")->valueint;
-  procStat->a = cJSON_GetObjectItemCaseSensitive(json, "a")->valueint;
-  procStat->p = cJSON_GetObjectItemCaseSensitive(json, "p")->valueint;
-  procStat->s = cJSON_GetObjectItemCaseSensitive(json, "s")->valueint;
-  procStat->pc = cJSON_GetObjectItemCaseSensitive(json, "pc")->valueint;
-  char tempStr[MAX_STR];
+// from the state of a test
+void populateProcStructWithTest(TestState* test, processorState* procStat, uint8_t opcode){
+
+  procStat->x = test->x;
+  procStat->y = test->y;
+  procStat->a = test->a;
+  procStat->p = test->p;
+  procStat->s = test->s;
+  procStat->pc = test->pc;
   procStat->lastOpCode = opcode;
 
 
@@ -1102,7 +1593,7 @@ void printCpu(CPU* cpu){
   printf("x: %.4d \n", cpu->x);
   printf("y: %.4d \n", cpu->y);
   printf("a: %.4d \n", cpu->a);
-  printf("pf: %.4d \n", cpu->pf);
+  printf("pf: %.4d \n", getStatus(cpu));
   printf("sp: %.4d \n", cpu->sp);
   printf("pc: %.4d \n", cpu->pc);
 
@@ -1116,7 +1607,7 @@ void printCpuWithJson(CPU* cpu, processorState final, int errorCode){
   printf("x: %.4d  - %.4d \n", cpu->x, final.x);
   printf("y: %.4d  - %.4d \n", cpu->y, final.y);
   printf("a: %.4d  - %.4d \n", cpu->a, final.a);
-  printf("pf: %.4d  - %.4d \n", cpu->pf, final.p);
+  printf("pf: %.4d  - %.4d \n", getStatus(cpu), final.p);
   printf("sp: %.4d - %.4d \n", cpu->sp, final.s);
   printf("pc: %.4d - %.4d \n", cpu->pc, final.pc);
 
@@ -1143,31 +1634,31 @@ void printProcState(processorState* state){
 // 4 - sp
 // 5 - pc
 //
-int checkProcState(CPU* cpu, cJSON* json){
+int checkProcState(CPU* cpu, TestState* test){
 
 
   int errorCode = 0;
-  if(cpu->x != cJSON_GetObjectItemCaseSensitive(json, "x")->valueint){
+  if(cpu->x != test->x){
     errorCode = setBit(errorCode, 0);
   } 
 
-  if(cpu->y != cJSON_GetObjectItemCaseSensitive(json, "y")->valueint){
+  if(cpu->y != test->y){
    errorCode = setBit(errorCode, 1);
   } 
 
-  if(cpu->a != cJSON_GetObjectItemCaseSensitive(json, "a")->valueint){
+  if(cpu->a != test->a){
     errorCode = setBit(errorCode, 2);
   } 
 
-  if(cpu->pf != cJSON_GetObjectItemCaseSensitive(json, "p")->valueint){
+  if(getStatus(cpu) != test->p){
     errorCode = setBit(errorCode, 3);
   } 
 
-  if(cpu->sp != cJSON_GetObjectItemCaseSensitive(json, "s")->valueint){
+  if(cpu->sp != test->s){
     errorCode = setBit(errorCode, 4);
   } 
 
-  if(cpu->pc != cJSON_GetObjectItemCaseSensitive(json, "pc")->valueint){
+  if(cpu->pc != test->pc){
     errorCode = setBit(errorCode, 5);
   }
   return errorCode;
@@ -1176,15 +1667,15 @@ int checkProcState(CPU* cpu, cJSON* json){
 }
 
 
-int populateProcStateWithJson(cJSON* json, Bus* bus){
+int populateProcStateWithTest(TestState* test, Bus* bus){
 
 
-  bus->cpu->x = cJSON_GetObjectItemCaseSensitive(json, "x")->valueint;
-  bus->cpu->y = cJSON_GetObjectItemCaseSensitive(json, "y")->valueint;
-  bus->cpu->a = cJSON_GetObjectItemCaseSensitive(json, "a")->valueint;
-  bus->cpu->pf = cJSON_GetObjectItemCaseSensitive(json, "p")->valueint;
-  bus->cpu->sp = cJSON_GetObjectItemCaseSensitive(json, "s")->valueint;
-  bus->cpu->pc = cJSON_GetObjectItemCaseSensitive(json, "pc")->valueint;
+  bus->cpu->x = test->x;
+  bus->cpu->y = test->y;
+  bus->cpu->a = test->a;
+  setStatus(bus->cpu, test->p);
+  bus->cpu->sp = test->s;
+  bus->cpu->pc = test->pc;
 
 
   return 1;
@@ -1192,22 +1683,24 @@ int populateProcStateWithJson(cJSON* json, Bus* bus){
 
 
 
-// checks memory against a cjson array
-// assumes that the json object is called "ram" and it is a 2d array, with every array element having 2 entries
-int checkMemWithJson(Bus* bus, cJSON* json){
+// checks memory against the ram list of a test
+// printErrors - set to 0 to not print the mismatched values
+int checkMemWithTest(Bus* bus, const uint8_t* ram, int numOfRam, int printErrors){
 
   uint16_t addr;
   uint8_t val;
   int isFailed = 0;
 
-  for(int i = 0; i < cJSON_GetArraySize(json); ++i){
-    addr = cJSON_GetArrayItem(cJSON_GetArrayItem(json,i),0)->valueint;
-    val = cJSON_GetArrayItem(cJSON_GetArrayItem(json,i),1)->valueint;
+  for(int i = 0; i < numOfRam; ++i){
+    addr = testRamAddr(ram, i);
+    val = testRamValue(ram, i);
     if(readBus(bus, addr) == val){
       continue;
     } else {
-      printf("Incorrect memory value at %d with %d \n", addr, val);
-      printf("\tReadbus: %d \n", readBus(bus, addr));
+      if(printErrors == 1){
+        printf("Incorrect memory value at %d with %d \n", addr, val);
+        printf("\tReadbus: %d \n", readBus(bus, addr));
+      }
       isFailed = 1;
     }
   }
@@ -1228,20 +1721,10 @@ void copyProcessorState(processorState* dest, processorState* src){
 
 }
 
-int populateMemWithJson(Bus* bus, cJSON* json){
-  uint16_t addr;
-  uint8_t val;
-  //printf("writing %d values \n", cJSON_GetArraySize(json));
-
-  for(int i = 0; i < cJSON_GetArraySize(json); ++i){
-    addr = cJSON_GetArrayItem(cJSON_GetArrayItem(json,i),0)->valueint;
-    val = cJSON_GetArrayItem(cJSON_GetArrayItem(json,i),1)->valueint;
-    writeBus(bus, addr, val);
-
-    //printf("Writing to bus at %d with %d \n", addr, val);
-    //printf("Reading to bus at %d with %d \n", addr, readBus(bus, addr));
-    
+int populateMemWithTest(Bus* bus, const uint8_t* ram, int numOfRam){
 
+  for(int i = 0; i < numOfRam; ++i){
+    writeBus(bus, testRamAddr(ram, i), testRamValue(ram, i));
   }
   return 1;
 
@@ -1251,127 +1734,219 @@ int populateMemWithJson(Bus* bus, cJSON* json){
 // takes the file directory where the tom harte tests reside and will run them
 // ranges from 00.json to ff.json
 // inputs:
-//   char* - complete path of json file, relative to executable
+//   char* - complete path of the test file, relative to executable. either json or the binary format
+//           made by convertJsonTests() (see testvectors.h)
 //   Bus* -  bus to be tested
+//   processorState* - if not NULL, gets the expected state of the last test run, with errorFlag set if it failed.
+//                     nothing is printed in this case, so that it can be called from multiple threads
 int jsonTester(char* file, Bus* bus, processorState* state){
-  FILE *fptr;
-
-
-  fptr = fopen(file, "r");
-  int fileLength;
+  TestVectors vectors;
+  TestVector test;
+  processorState finalStruct = {0};
+  uint8_t oppCode;
+  int errorCode;
+  int i = 0;
 
-  if(fptr == NULL){
-    printf("File does not exist \n");
+  errorCode = openTestVectors(&vectors, file);
+  if(errorCode == -1){
+    if(state == NULL){
+      printf("File does not exist \n");
+    }
+    return -1;
+  } else if(errorCode == 0){
+    if(state == NULL){
+      printf("Could not read tests from %s \n", file);
+    }
     return -1;
   }
 
-  // determines length of file
-  fseek(fptr, 0L, SEEK_END);
-  fileLength = ftell(fptr);
-  fseek(fptr, 0L, SEEK_SET);
-
-
-  char fileContents[fileLength+1];
-  (void)!fread(fileContents, sizeof(char), fileLength, fptr);
-  fileContents[fileLength] = '\0';
-  //fgets(fileContents, fileLength, fptr);
-  //printf("File Size: %d \n", fileLength);
-  //printf("%s \n", fileContents);
-  
-  
-  
-  
- 
-  cJSON* jsonData = cJSON_Parse(fileContents);
-  //cJSON* jsonDataArr = cJSON_CreateArray(); 
-  //cJSON_AddItemToArray(jsonDataArr, jsonData);
-  cJSON* name;
-  cJSON* initial;
-  cJSON* final;
-  cJSON* initRam;
-  cJSON* finalRam;
-  processorState initStruct;
-  processorState finalStruct;
-
-  uint8_t oppCode;
-  int errorCode;
-  char input[MAX_STR];
-  strcpy(input, "0");
-
-
-  for(int i = 0; i < cJSON_GetArraySize(jsonData); ++i){
-  // parse json information from the json array
-    name = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(jsonData,i), "name");
-    initial = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(jsonData,i), "initial");
-    final = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(jsonData,i), "final");
-    initRam = cJSON_GetObjectItemCaseSensitive(initial, "ram");
-    finalRam = cJSON_GetObjectItemCaseSensitive(final, "ram");
-    //pc = cJSON_GetObjectItemCaseSensitive(initial, "pc");
-    //cJSON* title = cJSON_GetObjectItemCaseSensitive(glossary, "title");
-    //if(SUPPRESSOUTPUT == 0)
-     // printf("Test Name %s \n", name->valuestring);
-  
+  while((errorCode = nextTestVector(&vectors, &test)) == 1){
     // setup cpu and testing environment
-
-    //printf("memory address of memarr %lx for %s \n", bus->memArr, file);
-
     reset(bus->cpu, bus);
     clearMem(&bus->memArr[0]);
-    populateProcStateWithJson(initial, bus);
-    //if(SUPPRESSOUTPUT == 0)
-     // printCpu(bus->cpu);
-    //populateProcState(final, bus);
-    populateMemWithJson(bus, initRam);
+    flushDecodeCache(bus);
+    populateProcStateWithTest(&test.initial, bus);
+    populateMemWithTest(bus, test.initRam, test.numOfInitRam);
 
 
     // start cpu and run test
     oppCode = readBus(bus, bus->cpu->pc); 
-    //if(SUPPRESSOUTPUT == 0)
-    //printf("Executing Oppcode 0x%x at %d\n", oppCode, bus->cpu->pc);
-    decodeAndExecute(bus->cpu, bus, oppCode);
-
-    //fputs("\n", stdout);
-    populateProcStructWithJson(final, &finalStruct, oppCode);
-    //if(SUPPRESSOUTPUT == 0)
-    //  printCpuWithJson(bus->cpu, finalStruct, errorCode);
+    if(bus->decodeCache == 1){
+      decodeAndExecuteCached(bus->cpu, bus);
+    } else {
+      decodeAndExecute(bus->cpu, bus, oppCode);
+    }
 
+    populateProcStructWithTest(&test.final, &finalStruct, oppCode);
+    errorCode = checkProcState(bus->cpu, &test.final);
 
-    if(checkProcState(bus->cpu, final) == 0 && checkMemWithJson(bus, finalRam) == 0){
-      //if(SUPPRESSOUTPUT == 0)
-       // printf("Passed! \n \n");
-      
-    } else {
+    if(errorCode != 0 || checkMemWithTest(bus, test.finalRam, test.numOfFinalRam, state == NULL) != 0){
+      if(state == NULL){
         printf("Failed! \n Passed %d tests! \n", i);
-        printf("Test Name %s \n", name->valuestring);
+        printf("Test Name %.*s \n", test.nameLength, test.name);
         printCpuWithJson(bus->cpu, finalStruct, errorCode);
-      if(state != NULL)
+      } else {
+        finalStruct.errorFlag = 1;
         copyProcessorState(state, &finalStruct);
+      }
+      closeTestVectors(&vectors);
       return 0;
-   
     }
+    i++;
+  }
+
+  if(errorCode == -1){
+    if(state == NULL){
+      printf("%s is cut short after %d tests \n", file, i);
+    }
+    closeTestVectors(&vectors);
+    return -1;
+  }
 
+  if(state != NULL){
+    finalStruct.errorFlag = 0;
+    copyProcessorState(state, &finalStruct);
+  }
 
-  //  while(input[0] != 'c'){
-  //    fgets(input, MAX_STR, stdin);
+  closeTestVectors(&vectors);
+  return 1;
 
-  //  }
-  //strcpy(input, "0");
-  
+}
+
+
+// jsonStateHash()
+//   runs every test in a file, whether it passes or not, and hashes the state the cpu and ram are left in
+//   along with the cycles each test took. the same file gives the same hash on any bus, used by -c
+// inputs:
+//   char* - path of the json or binary test file
+//   Bus* - bus to be tested
+// outputs:
+//   uint64_t* - fnv-1a hash of the outcome of every test
+// returns 1 on success, -1 if the file couldn't be read
+int jsonStateHash(char* file, Bus* bus, uint64_t* hash){
+  TestVectors vectors;
+  TestVector test;
+  uint8_t state[9];
+  int cycles;
+  int errorCode;
+
+  *hash = 0xcbf29ce484222325ULL;
+  if(openTestVectors(&vectors, file) != 1){
+    return -1;
   }
 
-   //int val = cJSON_GetArrayItem(cJSON_GetArrayItem(initRam,0),1)->valueint;
-//  char* str = cJSON_Print(cJSON_GetArrayItem(cJSON_GetArrayItem(initRam,0),0));
-  //printf("%s \n", str);
-  //printf("%d \n", val);
-   
+  while((errorCode = nextTestVector(&vectors, &test)) == 1){
+    reset(bus->cpu, bus);
+    clearMem(&bus->memArr[0]);
+    flushDecodeCache(bus);
+    populateProcStateWithTest(&test.initial, bus);
+    populateMemWithTest(bus, test.initRam, test.numOfInitRam);
 
+    if(bus->decodeCache == 1){
+      cycles = decodeAndExecuteCached(bus->cpu, bus);
+    } else {
+      cycles = decodeAndExecute(bus->cpu, bus, readBus(bus, bus->cpu->pc));
+    }
 
+    state[0] = bus->cpu->a;
+    state[1] = bus->cpu->x;
+    state[2] = bus->cpu->y;
+    state[3] = getStatus(bus->cpu);
+    state[4] = bus->cpu->sp;
+    state[5] = bus->cpu->pc & 0xff;
+    state[6] = bus->cpu->pc >> 8;
+    state[7] = cycles & 0xff;
+    state[8] = cycles >> 8;
+    for(int i = 0; i < 9; ++i){
+      *hash = (*hash ^ state[i]) * 0x100000001b3ULL;
+    }
+    // every address the test sets up or expects, so a stray write to any of them shows up
+    for(int i = 0; i < test.numOfInitRam; ++i){
+      *hash = (*hash ^ readBus(bus, testRamAddr(test.initRam, i))) * 0x100000001b3ULL;
+    }
+    for(int i = 0; i < test.numOfFinalRam; ++i){
+      *hash = (*hash ^ readBus(bus, testRamAddr(test.finalRam, i))) * 0x100000001b3ULL;
+    }
+  }
 
-   if(state != NULL)
-        copyProcessorState(state, &finalStruct);
-   
-  return 1;
+  closeTestVectors(&vectors);
+  return errorCode == -1 ? -1 : 1;
+}
+
+
+// jsonTesterThread()
+//   worker for jsonTesterParallel(), keeps taking files until there are none left
+void* jsonTesterThread(void* args){
+  ArgsForThreads* threadArgs = (ArgsForThreads*)args;
+  TestResults* result;
+  CPU* cpu = threadArgs->bus->cpu;
+  int fileNum;
 
+  while(1){
+    pthread_mutex_lock(threadArgs->lock);
+    fileNum = (*threadArgs->nextFile)++;
+    pthread_mutex_unlock(threadArgs->lock);
+    if(fileNum >= threadArgs->numOfFiles){
+      break;
+    }
+
+    result = &threadArgs->testResults[fileNum];
+    strncpy(result->name, threadArgs->files[fileNum], MAX_STR - 1);
+    result->name[MAX_STR - 1] = '\0';
+    if(threadArgs->hashFlag == 1){
+      result->passFlag = jsonStateHash(threadArgs->files[fileNum], threadArgs->bus, &result->stateHash);
+      continue;
+    }
+    result->passFlag = jsonTester(threadArgs->files[fileNum], threadArgs->bus, &result->json);
+    result->instruction = result->json.lastOpCode;
+
+    result->state.a = cpu->a;
+    result->state.x = cpu->x;
+    result->state.y = cpu->y;
+    result->state.s = cpu->sp;
+    result->state.pc = cpu->pc;
+    result->state.p = getStatus(cpu);
+  }
+
+  return NULL;
+}
+
+
+// jsonTesterParallel()
+//   runs every json file on its own bus, spread across numOfThreads threads.
+// inputs:
+//   char** - paths of the json files
+//   Bus* - array of numOfThreads buses, one for each thread
+//   int - number of files
+//   int - number of threads
+//   int - 1 to only hash the outcome of each file with jsonStateHash(), into stateHash
+// returns an array of results in the same order as the files, passFlag is 1 if every test in the file passed,
+// 0 if one failed and -1 if the file couldn't be opened
+TestResults* jsonTesterParallel(char** files, Bus* buses, int numOfFiles, int numOfThreads, int hashFlag){
+  TestResults* testResults = calloc(numOfFiles, sizeof(TestResults));
+  pthread_t* threads = malloc(numOfThreads * sizeof(pthread_t));
+  ArgsForThreads* threadArgs = malloc(numOfThreads * sizeof(ArgsForThreads));
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  int nextFile = 0;
+
+  for(int i = 0; i < numOfThreads; ++i){
+    threadArgs[i].bus = &buses[i];
+    threadArgs[i].files = files;
+    threadArgs[i].numOfFiles = numOfFiles;
+    threadArgs[i].nextFile = &nextFile;
+    threadArgs[i].lock = &lock;
+    threadArgs[i].testResults = testResults;
+    threadArgs[i].hashFlag = hashFlag;
+    pthread_create(&threads[i], NULL, jsonTesterThread, &threadArgs[i]);
+  }
+
+  for(int i = 0; i < numOfThreads; ++i){
+    pthread_join(threads[i], NULL);
+  }
+
+  free(threads);
+  free(threadArgs);
+  return testResults;
 }
 
 
@@ -1385,9 +1960,26 @@ void printHelp(){
   puts("       ernes [-h] \n");
   puts("       ernes [-n] [FILE] -s [SCALING INTEGER] \n");
   puts("\t -j [FILE] \t starts json tester with specfic json file \n");
+  puts("\t -p [DIR] \t runs every json test (00.json to ff.json) in a directory, using every core \n");
+  puts("\t -c [DIR] \t runs every json test in a directory on one thread, then on every core, and checks that both give the same results \n");
+  puts("\t -b [DIR] \t converts every json test in a directory into a binary file (00.bin to ff.bin) that loads faster with -j or -p \n");
   puts("\t -i [DIR] \t starts interpreter with 64k allocated to RAM \n");
   puts("\t -n [FILE] \t starts in NES mode with INES rom file \n");
     puts("\t -s [RESOLUTION SCALING INTEGER] \t integer amount to scale the resolution by (default: 1) \n");
+  puts("\t -d \t runs the cpu through the decode cache (with -n or -j) \n");
+  puts("\t -J \t runs the cpu through the jit (with -n, x86-64 linux only) \n");
+  puts("\t -k \t same as -J, but checks every compiled block against the interpreter (slow) \n");
+  puts("\t -A, --aot \t runs the cpu through the blocks built in with make AOT=FILE (with -n, mappers 0, 2 and 3) \n");
+  puts("\t --translate [FILE] \t translates the rom's PRG-ROM into c and writes it to FILE (with -n), to be built in with make AOT=FILE \n");
+  puts("\t --headless \t runs the rom (with -n) without SDL and as fast as possible, then prints how long it took. the only way to run a rom when built with make HEADLESS=1 \n");
+  puts("\t --frames [N] \t number of frames to run with --headless, 0 to run until --until is met (default: 600) \n");
+  puts("\t --until [ADDR=VALUE] \t stops --headless once the byte at ADDR is VALUE (or isn't, with ADDR!=VALUE), checked every frame. both in hex \n");
+  puts("\t --hash \t prints a hash of the final frame with --headless \n");
+  puts("\t --dump [FILE] \t writes the final frame to FILE as a .ppm with --headless \n");
+  puts("\t --frameskip [N] \t only draws one frame out of every N + 1, running N + 1 times as fast (with -n) \n");
+  puts("\t --compositor [scalar|sse2|avx2] \t picks how sprites and the background are merged (default: the fastest one the cpu supports) \n");
+  puts("\t --check-fused \t checks the idioms the decode cache fuses against running them one instruction at a time on random roms, then exits \n");
+  puts("\t --check-compositor \t checks the sse2 and avx2 compositors against the scalar one on random scanlines, then exits \n");
   puts("\t NOTE: To use -j or -i flags, make sure to set the NESEMU to 0 macro in general.h and recompile, otherwise keep it set to 1 to compile the NES emulator code");
 
 
@@ -1400,9 +1992,11 @@ void freeAndExit(Bus* bus){
 
   printf("Freeing memory and exiting... \n");
 
-  for(int i = 0; i < WINDOW_HEIGHT; ++i){
-
-    free(bus->ppu->frameBuffer[i]);
+  if(bus->jit != NULL){
+    if(bus->jit->check == 1){
+      printf("jit: %d blocks compiled, %d failed the check \n", bus->jit->blocksCompiled, bus->jit->checkFailures);
+    }
+    freeJit(bus);
   }
 
   free(bus->ppu->frameBuffer);
@@ -1411,6 +2005,8 @@ void freeAndExit(Bus* bus){
   free(bus->ppu->paletteram);
   for(int i = 0; i < bus->ppu->ppubus->numOfBlocks; ++i){
     free(bus->ppu->ppubus->memArr[i].contents);
+    free(bus->ppu->ppubus->memArr[i].chrTiles);
+    free(bus->ppu->ppubus->memArr[i].chrTileDirty);
   }
   free(bus->ppu->ppubus->memArr);
   free(bus->ppu->ppubus);
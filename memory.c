@@ -30,7 +30,8 @@
 
 void initMemStruct(Mem* mem, uint64_t size, enum DeviceType type, int inuse){
   if(inuse == TRUE){
-    mem->contents = calloc(size, sizeof(uint8_t));
+    // mapMemory() maps a block up to and including startAddr + size, so there's one byte more than size
+    mem->contents = calloc(size + 1, sizeof(uint8_t));
     mem->size = size;
   } else {
     mem->size = 0;
@@ -41,15 +42,20 @@ void initMemStruct(Mem* mem, uint64_t size, enum DeviceType type, int inuse){
   mem->endAddr = 0;
   mem->inuse = inuse;
   mem->mapped = 0;
+  mem->decoded = NULL;
+  mem->jitBlocks = NULL;
+  mem->chrTiles = NULL;
+  mem->chrTileDirty = NULL;
 
   clearMem(mem);
 }
 
 
 void clearMem(Mem* mem){
-  for(int i = 0; i < mem->size; ++i){
-    mem->contents[i] = 0xff;
+  if(mem->inuse != TRUE){
+    return;
   }
+  memset(mem->contents, 0xff, mem->size + 1);
 }
 
 
@@ -144,6 +150,57 @@ void initBus(Bus* bus, uint16_t banks){
   bus->presenceOfPrgRam = 0;
   bus->prgRamBankSelect = 0;
   initMmc1(&bus->mmc1); 
+
+  for(int i = 0; i < 0x100; ++i){
+    bus->readPages[i] = NULL;
+    bus->writePages[i] = NULL;
+    bus->decodedPages[i] = NULL;
+    bus->jitPages[i] = NULL;
+  }
+  bus->decodeCache = 0;
+  bus->jit = NULL;
+}
+
+
+// enableDecodeCache()
+//   allocates a decode cache for every memory block on the bus and maps it in, so that
+//   decodeAndExecuteCached() can skip fetching and decoding instructions it has already seen.
+//   has to be called after the memory blocks have been allocated
+void enableDecodeCache(Bus* bus){
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    if(bus->memArr[i].contents != NULL && bus->memArr[i].decoded == NULL){
+      bus->memArr[i].decoded = calloc(bus->memArr[i].size, sizeof(DecodedOp));
+    }
+  }
+  bus->decodeCache = 1;
+  updatePageTable(bus);
+}
+
+
+// flushDecodeCache()
+//   throws away every decoded instruction. needed whenever memory gets changed without going through writeBus
+void flushDecodeCache(Bus* bus){
+  for(int i = 0; i < bus->numOfBlocks; ++i){
+    if(bus->memArr[i].decoded != NULL){
+      memset(bus->memArr[i].decoded, 0, bus->memArr[i].size * sizeof(DecodedOp));
+    }
+  }
+}
+
+
+// invalidateDecodedOps()
+//   a write to addr may have changed the instruction starting at addr, or one of the two before it
+//   whose operand covers addr
+static inline void invalidateDecodedOps(Bus* bus, uint16_t addr){
+  DecodedOp* page;
+  uint16_t temp;
+  for(int i = 0; i < 3; ++i){
+    temp = addr - i;
+    page = bus->decodedPages[temp >> 8];
+    if(page != NULL){
+      page[temp & 0xff].handler = NULL;
+    }
+  }
 }
 
 #if NESEMU == 0
@@ -172,6 +229,9 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
 
       bus->memArr[i].contents[addr] = val;
       //printf("Writing to %d with %d \n", addr, val);
+      if(bus->decodeCache == 1){
+        invalidateDecodedOps(bus, addr);
+      }
       break;
     } 
   }
@@ -182,27 +242,35 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
 
 #elif NESEMU == 1
 
-// hard-coded for nes memory map
-// does not make use of the bounds checking of the starAddr and endAddr for each Mem struct
-void writeBus(Bus* bus, uint16_t addr, uint8_t val){
-  int prevVal;
+// writeBusHandler()
+//   slow path of writeBus, used for the pages that don't have a direct pointer in the page table.
+//   handles the ppu and controller registers along with the mapper registers
+static void writeBusHandler(Bus* bus, uint16_t addr, uint8_t val){
   
-  if(addr <= 0x07ff){
-    bus->memArr[0].contents[addr] = val;
-  } else if(addr >= 0x0800 && addr <= 0x0fff){
-    bus->memArr[0].contents[addr - 0x800] = val;
-  } else if(addr >= 0x1000 && addr <= 0x17ff){
-    bus->memArr[0].contents[addr - 0x1000] = val;
-  } else if(addr >= 0x1800 && addr <= 0x1fff){
-    bus->memArr[0].contents[addr - 0x1800] = val;
-  } else if(addr >= 0x2000 && addr <= 0x3fff){
+  if(addr >= 0x2000 && addr <= 0x3fff){
+    // the ppu runs up to this write with the old value
+    tickPpu(bus);
     switch(((addr % 8) + 0x2000)){
       case 0x2000:
+        if(((bus->ppu->ctrl ^ val) & 0x10) != 0){
+          bus->ppu->lineDirty |= LINE_REFETCH;
+        }
         bus->ppu->ctrl = val & 0xfc;
         bus->ppu->tregister.vcomp.nameTableSelect = (val & 0b11);
         break;
       case 0x2001:
-        bus->ppu->mask = val;
+        if(((bus->ppu->mask ^ val) & 0x08) != 0){
+          bus->ppu->lineDirty |= LINE_REFETCH;
+        } else if(((bus->ppu->mask ^ val) & 0x10) != 0){
+          bus->ppu->lineDirty |= LINE_RECOMPOSITE;
+        }
+        if(((bus->ppu->mask ^ val) & 0xe1) != 0){
+          // greyscale or emphasis changed, which are applied through the palette cache
+          bus->ppu->mask = val;
+          updatePaletteCache(bus->ppu);
+        } else {
+          bus->ppu->mask = val;
+        }
         break;
       case 0x2002:
         return;
@@ -211,9 +279,13 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
         break;
       case 0x2004:
         bus->ppu->oam[bus->ppu->oamaddr] = val;
+        bus->ppu->spriteLinesDirty = 1;
         break;
       case 0x2005:
         if(bus->ppu->wregister == 0){
+          if(bus->ppu->xregister != (val & 0x07)){
+            bus->ppu->lineDirty |= LINE_RECOMPOSITE;
+          }
           bus->ppu->xregister = (val & 0x07);
           bus->ppu->tregister.vcomp.courseX = ((val & 0xf8) >> 3);
           bus->ppu->wregister = 1;
@@ -234,11 +306,16 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
           bus->ppu->tregister.vreg = bus->ppu->tregister.vreg | ((uint16_t) val);
           bus->ppu->vregister.vreg = bus->ppu->tregister.vreg;
           bus->ppu->wregister = 0;
+          moveLineStart(bus->ppu);
         }
         
         break;
       case 0x2007:
         
+        // palette writes go through the palette cache, anything else could be part of the background row
+        if((bus->ppu->vregister.vreg & 0x3fff) < 0x3f00){
+          bus->ppu->lineDirty |= LINE_REFETCH;
+        }
         writePpuBus(bus->ppu, bus->ppu->vregister.vreg, val);
         if(getBit(bus->ppu->ctrl, 2) == 0){
           bus->ppu->vregister.vreg++;
@@ -250,6 +327,7 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
         break;
     }
   } else if(addr == 0x4014){
+    tickPpu(bus);
     bus->ppu->oamdma = val;
     dmaTransfer(bus);
   } else if(addr == 0x4016){
@@ -274,6 +352,12 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
     } 
 
   } else {
+
+    // mapper registers can switch CHR banks or mirroring
+    if(addr >= 0x8000 && bus->mapper != 0){
+      tickPpu(bus);
+      bus->ppu->lineDirty |= LINE_REFETCH;
+    }
     
     // NROM mapper (the basic bitch mapper)
     switch(bus->mapper){
@@ -335,6 +419,9 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
               // gets reset once the data from the shift register has been latched into the appropriate
               // internal register.
               bus->mmc1.shiftRegister.reg = 0x10;
+
+              // the prg banks visible to the cpu may have changed
+              updatePageTable(bus);
             }
           }
           copyMmc1(&bus->mmc1, &bus->ppu->mmc1Copy);
@@ -348,6 +435,7 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
           } else if(bus->numOfBlocks > 9){
             bus->bankSelect = bus->bankSelect & 0xf;
           }
+          updatePageTable(bus);
         }
         break;
       case 3:
@@ -358,6 +446,7 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
       case 7:
         if(addr >= 0x8000){
           bus->bankSelect = val & 0b111;
+          updatePageTable(bus);
         }
       }
     }
@@ -365,6 +454,24 @@ void writeBus(Bus* bus, uint16_t addr, uint8_t val){
 
 };
 
+// hard-coded for nes memory map
+// does not make use of the bounds checking of the starAddr and endAddr for each Mem struct
+//
+// plain memory is written through the page table, everything else goes to writeBusHandler()
+void writeBus(Bus* bus, uint16_t addr, uint8_t val){
+  uint8_t* page = bus->writePages[addr >> 8];
+
+  if(page != NULL){
+    page[addr & 0xff] = val;
+    if(bus->decodeCache == 1){
+      invalidateDecodedOps(bus, addr);
+    }
+    return;
+  }
+
+  writeBusHandler(bus, addr, val);
+}
+
 #endif
 
 
@@ -391,27 +498,40 @@ uint8_t readBus(Bus* bus, uint16_t addr){
 
 }
 
+// updatePageTable()
+//   the flat 64kb memory map doesn't use the page table for reads and writes,
+//   it's only used for mapping in the decode cache
+void updatePageTable(Bus* bus){
+  Mem* mem;
+  uint16_t addr;
+  for(int i = 0; i < 0x100; ++i){
+    bus->decodedPages[i] = NULL;
+    addr = i << 8;
+    for(int j = 0; j < bus->numOfBlocks; ++j){
+      mem = &(bus->memArr[j]);
+      if(mem->decoded != NULL && mem->startAddr <= addr && mem->endAddr >= addr + 0xff && mem->size >= addr - mem->startAddr + 0x100){
+        bus->decodedPages[i] = mem->decoded + (addr - mem->startAddr);
+        break;
+      }
+    }
+  }
+}
+
 #elif NESEMU == 1
 
-// hard-coded for nes memory map
-// does not make use of the bounds checking of the starAddr and endAddr for each Mem struct
-uint8_t readBus(Bus* bus, uint16_t addr){
+// readBusHandler()
+//   slow path of readBus, used for the pages that don't have a direct pointer in the page table.
+//   handles the ppu and controller registers, anything else unmapped reads back as 0
+static uint8_t readBusHandler(Bus* bus, uint16_t addr){
   //printf("Reading address %x \n", addr);
   uint8_t temp = 0;
-  uint16_t temp16 = 0;
   if(bus->numOfBlocks == 0){
     return 0;
 
   }
-  if(addr >= 0 && addr <= 0x07ff){
-    return bus->memArr[0].contents[addr];
-  } else if(addr >= 0x0800 && addr <= 0x0fff){
-    return bus->memArr[0].contents[addr - 0x800];
-  } else if(addr >= 0x1000 && addr <= 0x17ff){
-    return bus->memArr[0].contents[addr - 0x1000];
-  } else if(addr >= 0x1800 && addr <= 0x1fff){
-    return bus->memArr[0].contents[addr - 0x1800];
-  } else if(addr >= 0x2000 && addr <= 0x3fff){
+  if(addr >= 0x2000 && addr <= 0x3fff){
+    // sprite 0 hit and the sprite overflow flag are set as the ppu runs
+    tickPpu(bus);
     switch(((addr % 8) + 0x2000)){
       case 0x2000:
         return 0;
@@ -529,125 +649,143 @@ uint8_t readBus(Bus* bus, uint16_t addr){
     } else {
       return 0;
     }
-  } else {
+  }
+  return 0;
+}
 
-    switch(bus->mapper){
-      // NROM mapper
-      case 0:
-        if(addr >= 0x8000){
-          // index 1 corresponds to PRG-ROM for mapper 0
-          return bus->memArr[1].contents[addr - 0x8000];
-        }
-        break;
-      case 1:
-        if(addr >= 0x6000 & addr <= 0x7fff){
-          // index 1 corresponds to PRG-RAM for mapper 1
-          if(bus->presenceOfPrgRam == 1){
-            
-            return bus->memArr[1].contents[addr - 0x6000];
+// hard-coded for nes memory map
+// does not make use of the bounds checking of the starAddr and endAddr for each Mem struct
+//
+// plain memory is read through the page table, everything else goes to readBusHandler()
+uint8_t readBus(Bus* bus, uint16_t addr){
+  uint8_t* page = bus->readPages[addr >> 8];
 
-          } else {
-            return 0;
-          }
+  if(page != NULL){
+    return page[addr & 0xff];
+  }
 
-        } else if(addr >= 0x8000){
-           
-          // we have a seperate variable for prgBankTemp because we need to make modifications to it without polluting the actual register
-          // that the game and CPU writes to.
-          MMC1Register prgBankTemp;
-          // the mask used for prgbank to index into memArr can vary on a few factors, so thus we use a function to find it
-          uint8_t maskForPrgBank = findPrgBankMask(bus, &prgBankTemp);
-          
-          // TODO: Implement outer 256kb bankswitching for the fixed 16kb bank
-          int divideOffsetIntoMemArr = 0;
-          // 32 kb mode
+  return readBusHandler(bus, addr);
+}
 
-          
-          if(((bus->mmc1.control.reg & 0b1100) == 0) || ((bus->mmc1.control.reg & 0b1100) == 0b0100)){
-            //printf("32kb mode \n");
+// mapPage()
+//   points the 256 byte page at cpu address page << 8 at offset into the given memory block.
+//   the page is left unmapped (NULL) if the block doesn't exist or is too small, so that it falls
+//   back to the handler
+static void mapPage(Bus* bus, int page, int block, int offset, int writable){
+  bus->readPages[page] = NULL;
+  bus->writePages[page] = NULL;
+  bus->decodedPages[page] = NULL;
+  bus->jitPages[page] = NULL;
+
+  if(block < 0 || block >= bus->numOfBlocks){
+    return;
+  }
+  if(bus->memArr[block].contents == NULL || bus->memArr[block].size < offset + 0x100){
+    return;
+  }
 
+  bus->readPages[page] = bus->memArr[block].contents + offset;
+  if(writable){
+    bus->writePages[page] = bus->memArr[block].contents + offset;
+  }
+  if(bus->memArr[block].decoded != NULL){
+    bus->decodedPages[page] = bus->memArr[block].decoded + offset;
+  }
+  if(bus->memArr[block].jitBlocks != NULL){
+    bus->jitPages[page] = bus->memArr[block].jitBlocks + offset;
+  }
+}
 
-            if(addr <= 0xbfff){
-              //printf("prgbank %x \n", bus->mmc1.prgBank.reg + 1 + bus->presenceOfPrgRam);
-              // + 1 + presenceofPrgRam because we need the offset after the initial RAM and potentially PRG-RAM, if present
-              return bus->memArr[(prgBankTemp.reg & maskForPrgBank) + 1 + bus->presenceOfPrgRam].contents[addr - 0x8000];
-            } else if(addr >= 0xc000){
-              uint8_t temp;
-              // plus one because we want to get the next 16kb chunk if we are in 32kb mode, since the memory is divided up into 16k chunks
-              // on the back end anyways. So we emulate a 32kb entire chunk this way.
-              temp = bus->memArr[(prgBankTemp.reg & maskForPrgBank) + 2 + bus->presenceOfPrgRam].contents[addr - 0xc000]; 
-              return temp;
+// mapPrgBank()
+//   maps a 16kb prg-rom bank into either $8000-$bfff or $c000-$ffff
+static void mapPrgBank(Bus* bus, uint16_t addr, int block){
+  for(int i = 0; i < 0x40; ++i){
+    mapPage(bus, (addr >> 8) + i, block, i << 8, FALSE);
+  }
+}
 
-            }
-            // if bit 2 and 3 equals 2
-          } else if ((bus->mmc1.control.reg & 0b1100) == 0b1000){
-            printf("16 kb first bank fixed mode \n");
-            // variable used for offsetting the 256kb bank offset into memArr (outer bank) for the first fixed bank
-            uint8_t suRomMemArrOffset = 0;
-            if((bus->numOfBlocks - (1 + bus->presenceOfPrgRam)) == 32){
-              if(getBit(bus->mmc1.chrBank0.reg, 4) != 0){
-                suRomMemArrOffset = 16;
-              }
-            } 
-           if(addr <= 0xbfff){
-            // 1 + bus->presenceofprgram because we need an offset of either 0 or 1 from this variable when determining whether
-            // prgram is present or not.
-              return bus->memArr[(1 + bus->presenceOfPrgRam + suRomMemArrOffset)].contents[addr - 0x8000];
-            } else if(addr >= 0xc000){
-              // + 2 because this is the offset into memArr, after the initial RAM bank at 0x0000-0x07ff and the first, 16kb fixed bank
-              return bus->memArr[((prgBankTemp.reg & maskForPrgBank) + bus->presenceOfPrgRam + 2)].contents[addr - 0xc000]; 
-            }
-            // if bit 2 and bit 3 equals 3
-          } else if ((bus->mmc1.control.reg & 0b1100) == 0b1100){
-            // variable used for offsetting the 256kb bank offset into memArr (outer bank) for the last fixed bank
-            uint8_t suRomMemArrOffset = 0;
-
-            // TODO: implement outer block for last fixed PRG-ROM bank
-            if((bus->numOfBlocks - (1 + bus->presenceOfPrgRam)) == 32){
-              if((getBit(bus->mmc1.chrBank0.reg, 4) == 0)){
-                //printf("selecting block 1 \n");
-                suRomMemArrOffset = 16;
-              } else {
-                suRomMemArrOffset = 0;
-                //printf("selecting block 2 \n");
-              }
-            } 
-           if(addr <= 0xbfff){
-            // 1 + bus->presenceofprgram because we need an offset of either 0 or 1 from this variable when determining whether
-            // prgram is present or not.
-              return bus->memArr[((prgBankTemp.reg & maskForPrgBank) + bus->presenceOfPrgRam + 1)].contents[addr - 0x8000];
-            } else if(addr >= 0xc000){
-              return bus->memArr[(bus->numOfBlocks - 1) - suRomMemArrOffset].contents[addr - 0xc000]; 
-            }
-            
+// updatePageTable()
+//   rebuilds the readPages/writePages table from the mapper state. Has to be called whenever
+//   the mapper changes which memory is visible to the cpu (bank switches) and once after the
+//   memory blocks have been allocated.
+void updatePageTable(Bus* bus){
+  for(int i = 0; i < 0x100; ++i){
+    bus->readPages[i] = NULL;
+    bus->writePages[i] = NULL;
+    bus->decodedPages[i] = NULL;
+    bus->jitPages[i] = NULL;
+  }
+
+  if(bus->numOfBlocks == 0){
+    return;
+  }
+
+  // 0x0000-0x07ff ram, mirrored up to 0x1fff
+  for(int i = 0; i < 0x20; ++i){
+    mapPage(bus, i, 0, (i & 0x7) << 8, TRUE);
+  }
+
+  switch(bus->mapper){
+    // NROM mapper
+    case 0:
+      // index 1 corresponds to PRG-ROM for mapper 0
+      for(int i = 0; i < 0x80; ++i){
+        mapPage(bus, 0x80 + i, 1, i << 8, FALSE);
+      }
+      break;
+    case 1:
+      {
+        if(bus->presenceOfPrgRam == 1){
+          // index 1 corresponds to PRG-RAM for mapper 1
+          for(int i = 0; i < 0x20; ++i){
+            mapPage(bus, 0x60 + i, 1, i << 8, TRUE);
           }
-          
-        }
-        break;
-      case 2:
-        if(addr >= 0x8000 && addr <= 0xbfff){
-          // offset of 1 here indexing into the array because index 0 is ram
-          return bus->memArr[bus->bankSelect + 1].contents[addr - 0x8000];
-        } else if(addr >= 0xc000){
-          // - 1 because you want to get the very last block of memory
-          return bus->memArr[bus->numOfBlocks - 1].contents[addr - 0xc000];
-        }
-      case 3:
-        if(addr >= 0x8000 && addr <= 0xbfff){
-          return bus->memArr[1].contents[addr - 0x8000];
-        } else if(addr >= 0xc000){
-          return bus->memArr[2].contents[addr - 0xc000];
         }
-      case 7:
-        if(addr >= 0x8000){
 
-          
-          return bus->memArr[bus->bankSelect + 1].contents[addr - 0x8000];
+        // same bank selection as what readBus used to do for every read, see findPrgBankMask()
+        MMC1Register prgBankTemp;
+        uint8_t maskForPrgBank = findPrgBankMask(bus, &prgBankTemp);
+        uint8_t suRomMemArrOffset = 0;
+        int suRom = (bus->numOfBlocks - (1 + bus->presenceOfPrgRam)) == 32;
+
+        if(((bus->mmc1.control.reg & 0b1100) == 0) || ((bus->mmc1.control.reg & 0b1100) == 0b0100)){
+          // 32 kb mode
+          mapPrgBank(bus, 0x8000, (prgBankTemp.reg & maskForPrgBank) + 1 + bus->presenceOfPrgRam);
+          mapPrgBank(bus, 0xc000, (prgBankTemp.reg & maskForPrgBank) + 2 + bus->presenceOfPrgRam);
+        } else if((bus->mmc1.control.reg & 0b1100) == 0b1000){
+          // 16 kb, first bank fixed
+          if(suRom && getBit(bus->mmc1.chrBank0.reg, 4) != 0){
+            suRomMemArrOffset = 16;
+          }
+          mapPrgBank(bus, 0x8000, 1 + bus->presenceOfPrgRam + suRomMemArrOffset);
+          mapPrgBank(bus, 0xc000, (prgBankTemp.reg & maskForPrgBank) + bus->presenceOfPrgRam + 2);
+        } else {
+          // 16 kb, last bank fixed
+          if(suRom && getBit(bus->mmc1.chrBank0.reg, 4) == 0){
+            suRomMemArrOffset = 16;
+          }
+          mapPrgBank(bus, 0x8000, (prgBankTemp.reg & maskForPrgBank) + bus->presenceOfPrgRam + 1);
+          mapPrgBank(bus, 0xc000, (bus->numOfBlocks - 1) - suRomMemArrOffset);
         }
-      
-    }
+      }
+      break;
+    case 2:
+      // offset of 1 here indexing into the array because index 0 is ram
+      mapPrgBank(bus, 0x8000, bus->bankSelect + 1);
+      mapPrgBank(bus, 0xc000, bus->numOfBlocks - 1);
+      break;
+    case 3:
+      mapPrgBank(bus, 0x8000, 1);
+      mapPrgBank(bus, 0xc000, 2);
+      break;
+    case 7:
+      // one 32kb bank
+      for(int i = 0; i < 0x80; ++i){
+        mapPage(bus, 0x80 + i, bus->bankSelect + 1, i << 8, FALSE);
+      }
+      break;
   }
-  return 0;
+
 }
 
 #endif
@@ -698,6 +836,11 @@ void writePpuBus(PPU* ppu, uint16_t addr, uint8_t val){
   }
 
 
+}
+// chrBank()
+//   there are no banked pattern tables in the flat memory layout, so nothing can be cached
+Mem* chrBank(PPU* ppu, uint16_t addr, uint16_t* offset){
+  return NULL;
 }
 #elif NESEMU == 1
 
@@ -812,12 +955,65 @@ uint8_t readPpuBus(PPU* ppu, uint16_t addr){
 }
 
 
+// chrBank()
+//   finds the CHR bank that readPpuBus() reads a pattern table address ($0000-$1fff) from
+//   inputs:
+//     addr - pattern table address
+//   outputs:
+//     offset - offset of addr into the bank
+//   return:
+//     the bank, or NULL if the mapper doesn't read CHR from a bank
+Mem* chrBank(PPU* ppu, uint16_t addr, uint16_t* offset){
+  MMC1Register temp;
+
+  *offset = addr;
+  switch(ppu->mapper){
+    case 0:
+    case 2:
+      return &(ppu->ppubus->memArr[0]);
+    case 1:
+      if(getBit(ppu->mmc1Copy.control.reg, 4) == 0){
+        temp.reg = ppu->mmc1Copy.chrBank0.reg;
+
+        // SNROM games omit bit 5 of chrBank0, same as readPpuBus()
+        if(ppu->ppubus->numOfBlocks == 4){
+          temp.reg = temp.reg & 0b1111;
+        }
+        if(addr <= 0xfff){
+          return &(ppu->ppubus->memArr[temp.reg & 0b11110]);
+        }
+        *offset = addr - 0x1000;
+        return &(ppu->ppubus->memArr[(temp.reg & 0b11110) + 1]);
+      }
+
+      if(addr <= 0xfff){
+        return &(ppu->ppubus->memArr[ppu->mmc1Copy.chrBank0.reg]);
+      }
+      *offset = addr - 0x1000;
+      return &(ppu->ppubus->memArr[ppu->mmc1Copy.chrBank1.reg]);
+    case 3:
+      return &(ppu->ppubus->memArr[ppu->bankSelect]);
+  }
+
+  return NULL;
+}
+
+// invalidateChrTile()
+//   marks the decoded copy of the tile at offset in a CHR bank as out of date, after the bank is written to
+void invalidateChrTile(Mem* mem, uint16_t offset){
+  if(mem->chrTileDirty != NULL){
+    mem->chrTileDirty[offset >> 4] = 1;
+  }
+}
+
+
 void writePpuBus(PPU* ppu, uint16_t addr, uint8_t val){
   //printf("Writing to PPU address %x with value %x \n", addr, val);
   if(addr <= 0x1fff){
     if(ppu->mapper == 0 || ppu->mapper == 2){
       if(ppu->ppubus->memArr[0].type == Ram){
         ppu->ppubus->memArr[0].contents[addr] = val;
+        invalidateChrTile(&(ppu->ppubus->memArr[0]), addr);
       } else {
         return;
       }
@@ -836,12 +1032,14 @@ void writePpuBus(PPU* ppu, uint16_t addr, uint8_t val){
         if(addr <= 0xfff){
           if(ppu->ppubus->memArr[temp & 0b1111].type == Ram){
             ppu->ppubus->memArr[temp & 0b11110].contents[addr] = val;
+            invalidateChrTile(&(ppu->ppubus->memArr[temp & 0b11110]), addr);
           } else {
             return;
           }
         } else if(addr >= 0x1000){
           if(ppu->ppubus->memArr[(temp & 0b11110) + 1].type == Ram){
             ppu->ppubus->memArr[(temp & 0b11110) + 1].contents[addr - 0x1000] = val;
+            invalidateChrTile(&(ppu->ppubus->memArr[(temp & 0b11110) + 1]), addr - 0x1000);
           } else {
             return;
           }
@@ -852,12 +1050,14 @@ void writePpuBus(PPU* ppu, uint16_t addr, uint8_t val){
         if(addr <= 0xfff){
           if(ppu->ppubus->memArr[ppu->mmc1Copy.chrBank0.reg].type == Ram){
             ppu->ppubus->memArr[ppu->mmc1Copy.chrBank0.reg].contents[addr] = val;
+            invalidateChrTile(&(ppu->ppubus->memArr[ppu->mmc1Copy.chrBank0.reg]), addr);
           } else {
             return;
           }
         } else if(addr >= 0x1000){
           if(ppu->ppubus->memArr[ppu->mmc1Copy.chrBank1.reg].type == Ram){
             ppu->ppubus->memArr[ppu->mmc1Copy.chrBank1.reg].contents[addr - 0x1000] = val;
+            invalidateChrTile(&(ppu->ppubus->memArr[ppu->mmc1Copy.chrBank1.reg]), addr - 0x1000);
           } else {
             return;
           }
@@ -1166,6 +1366,9 @@ void writePpuBus(PPU* ppu, uint16_t addr, uint8_t val){
     ppu->paletteram[addr - 0x3fe0] = val;
   } 
 
+  if(addr >= 0x3f00){
+    updatePaletteCache(ppu);
+  }
 
 }
 
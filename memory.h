@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include "cpu.h"
 #include "general.h"
+#include "scheduler.h"
 
 
 
@@ -37,6 +38,13 @@
 
 typedef struct _CPU CPU;
 typedef struct _PPU PPU;
+typedef struct _DecodedOp DecodedOp;
+typedef struct _Bus Bus;
+typedef struct _Jit Jit;
+
+// native code compiled by the jit for a block of instructions, see jit.c.
+// runs instructions until the block ends or the cycle budget runs out, returns the cycles taken
+typedef int (*JitBlock)(CPU*, Bus*, int);
 
 
 
@@ -60,6 +68,21 @@ typedef struct _Mem {
 
   // flag to show if the block of memory has been mapped to somewhere in memory yet
   int mapped;
+
+  // decode cache for any code run out of this block, one entry per byte.
+  // NULL unless the decode cache has been enabled with enableDecodeCache()
+  DecodedOp* decoded;
+
+  // compiled blocks for code in this block, one entry per byte. only used for PRG-ROM,
+  // NULL unless the jit has been enabled with initJit()
+  JitBlock* jitBlocks;
+
+  // CHR banks only: every 16 byte tile decoded to 64 pixels (0-3), 8 rows of 8 with the leftmost pixel first.
+  // NULL unless set up by initChrCache()
+  uint8_t* chrTiles;
+
+  // one entry per tile, 1 if the tile has been written to since it was last decoded
+  uint8_t* chrTileDirty;
 } Mem;
 
 // look at https://www.nesdev.org/wiki/MMC1 for understanding of MMC1 Registers
@@ -144,7 +167,23 @@ typedef struct _Bus {
 
   int presenceOfPrgRam;
 
+  // direct pointers to each 256 byte page of cpu memory, indexed by addr >> 8.
+  // NULL pages (i/o, mapper registers, open bus) go through the slow path in readBus/writeBus.
+  // rebuilt by updatePageTable() on bank switches
+  uint8_t* readPages[256];
+  uint8_t* writePages[256];
+
+  // decode cache entries for each 256 byte page, in the same way as readPages.
+  // all NULL unless decodeCache is set
+  DecodedOp* decodedPages[256];
+  int decodeCache;
 
+  // jit blocks for each 256 byte page, in the same way as readPages. NULL for anything that isn't PRG-ROM
+  JitBlock* jitPages[256];
+  Jit* jit;
+
+  // when the cpu should stop for the ppu's events, see scheduler.h
+  Scheduler scheduler;
 
 
 } Bus; 
@@ -159,11 +198,17 @@ void clearMem(Mem*);
 uint8_t readBus(Bus*, uint16_t);
 void writeBus(Bus*, uint16_t, uint8_t);
 void mapMemory(Bus*, uint16_t, uint16_t);
+void updatePageTable(Bus*);
+
+void enableDecodeCache(Bus*);
+void flushDecodeCache(Bus*);
 
 void initMmc1(MMC1*);
 
 uint8_t readPpuBus(PPU*, uint16_t);
 void writePpuBus(PPU*, uint16_t, uint8_t);
+Mem* chrBank(PPU*, uint16_t, uint16_t*);
+void invalidateChrTile(Mem*, uint16_t);
 
 uint8_t findPrgBankMask(Bus*, MMC1Register*);
 
@@ -0,0 +1,187 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+#pragma once
+
+// OPCODE_LIST()
+//   every official 6502 opcode as X(opcode, instruction, addressing mode, base cycles).
+//
+//   base cycles don't include the extra cycle for crossing a page on indexed reads or
+//   the cycles for taking a branch, those get added on by the instruction itself.
+//   BIT zero page and BIT absolute are kept at 4 and 3 cycles, which is what the cpu has always
+//   returned for them.
+//
+//   anything not in this list is an illegal opcode and is executed as a NOP
+#define OPCODE_LIST(X) \
+  X(0x00, brk, implied, 7) \
+  X(0x01, ora, indirectX, 6) \
+  X(0x05, ora, zeroPage, 3) \
+  X(0x06, asl, zeroPage, 5) \
+  X(0x08, php, implied, 3) \
+  X(0x09, ora, immediate, 2) \
+  X(0x0a, asl, accumulator, 2) \
+  X(0x0d, ora, absolute, 4) \
+  X(0x0e, asl, absolute, 6) \
+  X(0x10, bpl, relative, 2) \
+  X(0x11, ora, indirectY, 5) \
+  X(0x15, ora, zeroPageX, 4) \
+  X(0x16, asl, zeroPageX, 6) \
+  X(0x18, clc, implied, 2) \
+  X(0x19, ora, absoluteY, 4) \
+  X(0x1d, ora, absoluteX, 4) \
+  X(0x1e, asl, absoluteX, 7) \
+  X(0x20, jsr, absolute, 6) \
+  X(0x21, and, indirectX, 6) \
+  X(0x24, bit, zeroPage, 4) \
+  X(0x25, and, zeroPage, 3) \
+  X(0x26, rol, zeroPage, 5) \
+  X(0x28, plp, implied, 4) \
+  X(0x29, and, immediate, 2) \
+  X(0x2a, rol, accumulator, 2) \
+  X(0x2c, bit, absolute, 3) \
+  X(0x2d, and, absolute, 4) \
+  X(0x2e, rol, absolute, 6) \
+  X(0x30, bmi, relative, 2) \
+  X(0x31, and, indirectY, 5) \
+  X(0x35, and, zeroPageX, 4) \
+  X(0x36, rol, zeroPageX, 6) \
+  X(0x38, sec, implied, 2) \
+  X(0x39, and, absoluteY, 4) \
+  X(0x3d, and, absoluteX, 4) \
+  X(0x3e, rol, absoluteX, 7) \
+  X(0x40, rti, implied, 6) \
+  X(0x41, eor, indirectX, 6) \
+  X(0x45, eor, zeroPage, 3) \
+  X(0x46, lsr, zeroPage, 5) \
+  X(0x48, pha, implied, 3) \
+  X(0x49, eor, immediate, 2) \
+  X(0x4a, lsr, accumulator, 2) \
+  X(0x4c, jmp, absolute, 3) \
+  X(0x4d, eor, absolute, 4) \
+  X(0x4e, lsr, absolute, 6) \
+  X(0x50, bvc, relative, 2) \
+  X(0x51, eor, indirectY, 5) \
+  X(0x55, eor, zeroPageX, 4) \
+  X(0x56, lsr, zeroPageX, 6) \
+  X(0x58, cli, implied, 2) \
+  X(0x59, eor, absoluteY, 4) \
+  X(0x5d, eor, absoluteX, 4) \
+  X(0x5e, lsr, absoluteX, 7) \
+  X(0x60, rts, implied, 6) \
+  X(0x61, adc, indirectX, 6) \
+  X(0x65, adc, zeroPage, 3) \
+  X(0x66, ror, zeroPage, 5) \
+  X(0x68, pla, implied, 4) \
+  X(0x69, adc, immediate, 2) \
+  X(0x6a, ror, accumulator, 2) \
+  X(0x6c, jmp, absoluteIndir, 5) \
+  X(0x6d, adc, absolute, 4) \
+  X(0x6e, ror, absolute, 6) \
+  X(0x70, bvs, relative, 2) \
+  X(0x71, adc, indirectY, 5) \
+  X(0x75, adc, zeroPageX, 4) \
+  X(0x76, ror, zeroPageX, 6) \
+  X(0x78, sei, implied, 2) \
+  X(0x79, adc, absoluteY, 4) \
+  X(0x7d, adc, absoluteX, 4) \
+  X(0x7e, ror, absoluteX, 7) \
+  X(0x81, sta, indirectX, 6) \
+  X(0x84, sty, zeroPage, 3) \
+  X(0x85, sta, zeroPage, 3) \
+  X(0x86, stx, zeroPage, 3) \
+  X(0x88, dey, implied, 2) \
+  X(0x8a, txa, implied, 2) \
+  X(0x8c, sty, absolute, 4) \
+  X(0x8d, sta, absolute, 4) \
+  X(0x8e, stx, absolute, 4) \
+  X(0x90, bcc, relative, 2) \
+  X(0x91, sta, indirectY, 6) \
+  X(0x94, sty, zeroPageX, 4) \
+  X(0x95, sta, zeroPageX, 4) \
+  X(0x96, stx, zeroPageY, 4) \
+  X(0x98, tya, implied, 2) \
+  X(0x99, sta, absoluteY, 5) \
+  X(0x9a, txs, implied, 2) \
+  X(0x9d, sta, absoluteX, 5) \
+  X(0xa0, ldy, immediate, 2) \
+  X(0xa1, lda, indirectX, 6) \
+  X(0xa2, ldx, immediate, 2) \
+  X(0xa4, ldy, zeroPage, 3) \
+  X(0xa5, lda, zeroPage, 3) \
+  X(0xa6, ldx, zeroPage, 3) \
+  X(0xa8, tay, implied, 2) \
+  X(0xa9, lda, immediate, 2) \
+  X(0xaa, tax, implied, 2) \
+  X(0xac, ldy, absolute, 4) \
+  X(0xad, lda, absolute, 4) \
+  X(0xae, ldx, absolute, 4) \
+  X(0xb0, bcs, relative, 2) \
+  X(0xb1, lda, indirectY, 5) \
+  X(0xb4, ldy, zeroPageX, 4) \
+  X(0xb5, lda, zeroPageX, 4) \
+  X(0xb6, ldx, zeroPageY, 4) \
+  X(0xb8, clv, implied, 2) \
+  X(0xb9, lda, absoluteY, 4) \
+  X(0xba, tsx, implied, 2) \
+  X(0xbc, ldy, absoluteX, 4) \
+  X(0xbd, lda, absoluteX, 4) \
+  X(0xbe, ldx, absoluteY, 4) \
+  X(0xc0, cpy, immediate, 2) \
+  X(0xc1, cmp, indirectX, 6) \
+  X(0xc4, cpy, zeroPage, 3) \
+  X(0xc5, cmp, zeroPage, 3) \
+  X(0xc6, dec, zeroPage, 5) \
+  X(0xc8, iny, implied, 2) \
+  X(0xc9, cmp, immediate, 2) \
+  X(0xca, dex, implied, 2) \
+  X(0xcc, cpy, absolute, 4) \
+  X(0xcd, cmp, absolute, 4) \
+  X(0xce, dec, absolute, 6) \
+  X(0xd0, bne, relative, 2) \
+  X(0xd1, cmp, indirectY, 5) \
+  X(0xd5, cmp, zeroPageX, 4) \
+  X(0xd6, dec, zeroPageX, 6) \
+  X(0xd8, cld, implied, 2) \
+  X(0xd9, cmp, absoluteY, 4) \
+  X(0xdd, cmp, absoluteX, 4) \
+  X(0xde, dec, absoluteX, 7) \
+  X(0xe0, cpx, immediate, 2) \
+  X(0xe1, sbc, indirectX, 6) \
+  X(0xe4, cpx, zeroPage, 3) \
+  X(0xe5, sbc, zeroPage, 3) \
+  X(0xe6, inc, zeroPage, 5) \
+  X(0xe8, inx, implied, 2) \
+  X(0xe9, sbc, immediate, 2) \
+  X(0xea, nop, implied, 2) \
+  X(0xec, cpx, absolute, 4) \
+  X(0xed, sbc, absolute, 4) \
+  X(0xee, inc, absolute, 6) \
+  X(0xf0, beq, relative, 2) \
+  X(0xf1, sbc, indirectY, 5) \
+  X(0xf5, sbc, zeroPageX, 4) \
+  X(0xf6, inc, zeroPageX, 6) \
+  X(0xf8, sed, implied, 2) \
+  X(0xf9, sbc, absoluteY, 4) \
+  X(0xfd, sbc, absoluteX, 4) \
+  X(0xfe, inc, absoluteX, 7)
+
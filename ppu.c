@@ -25,10 +25,15 @@
 #include "cpu.h"
 #include "general.h"
 #include "memory.h"
+#include "compositor.h"
+#ifndef ERNES_HEADLESS
 #include <SDL2/SDL_render.h>
 #include <SDL2/SDL_video.h>
+#endif
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 
 
@@ -49,11 +54,9 @@ void initPpu(PPU* ppu, int banks){
   }
   ppu->ppubus->numOfBlocks = banks;
   printf("initializing PPU \n");
-  ppu->frameBuffer = malloc(sizeof(uint32_t*) * 242);
-  
-  for(int i = 0; i < 242; ++i){
-    ppu->frameBuffer[i] = calloc(WINDOW_WIDTH, sizeof(uint32_t));
-  } 
+  // one contiguous block of palette indices, aligned to a cache line. converted to RGB by convertFrameBuffer()
+  ppu->frameBuffer = aligned_alloc(64, sizeof(uint16_t) * WINDOW_WIDTH * FRAMEBUFFER_HEIGHT);
+  memset(ppu->frameBuffer, 0, sizeof(uint16_t) * WINDOW_WIDTH * FRAMEBUFFER_HEIGHT);
 
   
   ppu->ctrl = 0;
@@ -102,6 +105,12 @@ void resetPpu(PPU* ppu, int powerFlag){
   ppu->scanLineSprites = -1;
 
   ppu->prerenderScanlineFlag = 0;
+  ppu->skipFrame = 0;
+  ppu->lineStart = 0;
+  ppu->lineHit = -1;
+  ppu->lineDirty = 0;
+  ppu->spriteLinesDirty = 1;
+  updatePaletteCache(ppu);
   ppu->attributeData1 = 0;
   ppu->attributeData2 = 0;
 
@@ -124,6 +133,7 @@ void dmaTransfer(Bus* bus){
     addr = (((uint16_t)bus->ppu->oamdma) << 8) | i;
     bus->ppu->oam[i] = readBus(bus, addr);    
   }
+  bus->ppu->spriteLinesDirty = 1;
 }
 
 // populatePalette()
@@ -200,35 +210,50 @@ void populatePalette(PPU* ppu){
   ppu->palette[62] = 0x000000;
   ppu->palette[63] = 0x000000;
   
-
+  buildRgbLut(ppu);
+  updatePaletteCache(ppu);
 
 }
 
 
 
+#ifndef ERNES_HEADLESS
 // drawFramebuffer()
 //   draws Framebuffer to background layer in sdl 
-//   also converts the nes colour palette to rgb values when reading from the frame buffer
+//   the visible 240 rows are turned into RGB straight into the texture's pixels
 void drawFrameBuffer(PPU* ppu, SDL_Renderer* renderer, SDL_Texture* texture){
   //printf("drawing framebuffer \n");
-  uint32_t *pixels;
+  void* pixels;
   int pitch;
 
-
   SDL_RenderClear(renderer);
-  SDL_LockTexture(texture, NULL, (void**)&pixels, &pitch);
+  if(SDL_LockTexture(texture, NULL, &pixels, &pitch) == 0){
+    convertFrameBuffer(ppu, pixels, pitch);
+    SDL_UnlockTexture(texture);
+  }
+  SDL_RenderCopy(renderer, texture, NULL, NULL);
+  SDL_RenderPresent(renderer);
+
+}
+#endif
+
+
+// convertFrameBuffer()
+//   turns the visible WINDOW_HEIGHT rows of the framebuffer into RGB through rgbLut
+//   inputs:
+//     out - WINDOW_HEIGHT rows of WINDOW_WIDTH pixels
+//     pitch - bytes from the start of one row of out to the next
+void convertFrameBuffer(PPU* ppu, uint32_t* out, int pitch){
+  uint16_t* row;
+  uint32_t* outRow;
 
   for(int i = 0; i < WINDOW_HEIGHT; ++i){
+    row = ppu->frameBuffer + (i * WINDOW_WIDTH);
+    outRow = (uint32_t*)((uint8_t*)out + (i * pitch));
     for(int j = 0; j < WINDOW_WIDTH; ++j){
-      pixels[(i * WINDOW_WIDTH) + j] = ppu->frameBuffer[i][j];
-
+      outRow[j] = ppu->rgbLut[row[j]];
     }
   }
-
-  SDL_UnlockTexture(texture);
-  SDL_RenderCopy(renderer, texture, NULL, NULL);
-  SDL_RenderPresent(renderer);
-
 }
 
 void printNameTable(Bus* bus){
@@ -247,6 +272,46 @@ void printNameTable(Bus* bus){
 
 }
 
+// updatePaletteCache()
+//   resolves all 32 entries of palette ram to the palette index that ends up in the framebuffer, so the renderer
+//   can look a pixel up with one load. greyscale (PPUMASK bit 0) keeps only the colour's brightness and
+//   the emphasis bits (PPUMASK bits 5-7) go into the top of the index, so neither costs anything per pixel.
+//   called whenever palette ram ($3f00-$3fff) or PPUMASK's greyscale or emphasis bits are written to
+void updatePaletteCache(PPU* ppu){
+  uint8_t colourMask = getBit(ppu->mask, 0) != 0 ? 0x30 : 0x3f;
+  uint16_t emphasis = (uint16_t)(ppu->mask >> 5) << PALETTE_EMPHASIS_SHIFT;
+
+  for(int i = 0; i < 32; ++i){
+    ppu->paletteCache[i] = emphasis | (ppu->paletteram[i] & colourMask);
+  }
+}
+
+
+// buildRgbLut()
+//   works out the RGB colour of every palette index from the 64 colour palette. each emphasis bit darkens
+//   the two colour channels it doesn't emphasise to roughly 3/4
+void buildRgbLut(PPU* ppu){
+  uint32_t rgb;
+  uint32_t channel;
+  int emphasis;
+
+  for(int i = 0; i < PALETTE_INDICES; ++i){
+    rgb = ppu->palette[i & 0x3f];
+    emphasis = i >> PALETTE_EMPHASIS_SHIFT;
+
+    // bit 0 emphasises red, bit 1 green and bit 2 blue
+    for(int j = 0; j < 3; ++j){
+      if(emphasis & ~(1 << j)){
+        channel = (rgb >> ((2 - j) * 8)) & 0xff;
+        rgb &= ~(0xffu << ((2 - j) * 8));
+        rgb |= ((channel * 3) / 4) << ((2 - j) * 8);
+      }
+    }
+
+    ppu->rgbLut[i] = rgb;
+  }
+}
+
 int getEightSixteen(PPU* ppu){
 
   if(getBit(ppu->ctrl, 5) == 0){
@@ -271,340 +336,452 @@ void copyMmc1(MMC1* src, MMC1* dest){
 }
 
 
-// spriteEvaluation()
-//    performs a sprite evaluation on the PPU's OAM
+// bucketSprites()
+//   sorts every sprite in oam into the scanlines it covers, keeping them in oam order, so that each scanline
+//   doesn't have to search through the whole oam. only the first 8 sprites on a line are kept, a 9th one
+//   marks the line as overflowing
 // input:
 //   ppu - ppu to function on
 //   eightSixteenSpriteFlag - whether the game is an 8x8 or 8x16 sprite game
-// output:
-//   oamIndices - output array of oam indices
-// return:
-//   amount of sprites found on the current scanline
-int spriteEvaluation(PPU* ppu, uint8_t* oamIndices, int eightSixteenSpriteFlag){
-  int spriteEvalCounter = 0;
+void bucketSprites(PPU* ppu, int eightSixteenSpriteFlag){
+  int height = (eightSixteenSpriteFlag == 1) ? 16 : 8;
+  int line;
 
+  memset(ppu->spriteLineCount, 0, SPRITE_LINES);
 
-  for(uint16_t i = 0; i < 256; i = i + 4){
+  for(int i = 0; i < 256; i = i + 4){
 
     // ppu->oam[i] gets the Y coordinate of the tile
-    
-    if(eightSixteenSpriteFlag == 0){
-      if(ppu->oam[i] <= ppu->scanLineSprites && ppu->oam[i] + 7 >= ppu->scanLineSprites){
-        oamIndices[spriteEvalCounter] = (uint8_t) i;
-        spriteEvalCounter++;
+    for(int j = 0; j < height; ++j){
+      line = ppu->oam[i] + j;
+      if(line >= SPRITE_LINES){
+        break;
       }
-    } else if(eightSixteenSpriteFlag == 1){
-      if(ppu->oam[i] <= ppu->scanLineSprites && ppu->oam[i] + 15 >= ppu->scanLineSprites){
-        oamIndices[spriteEvalCounter] = i;
-        spriteEvalCounter++;
+
+      if(ppu->spriteLineCount[line] < 8){
+        ppu->spriteLines[line][ppu->spriteLineCount[line]] = (uint8_t) i;
+        ppu->spriteLineCount[line]++;
+      } else {
+        ppu->spriteLineCount[line] = 9;
       }
     }
+  }
 
-    if(spriteEvalCounter >= 8){
-      if(spriteEvalCounter == 8){
-        continue;
-      }
+  ppu->spriteLinesDirty = 0;
+  ppu->spriteLinesHeight = height;
+}
 
-      if(spriteEvalCounter >= 9){
-        ppu->status = setBit(ppu->status, 5);
-        spriteEvalCounter = 8;
-      }
-      break;
-    }
 
+// spriteEvaluation()
+//    performs a sprite evaluation on the PPU's OAM, using the sprites bucketed by bucketSprites().
+//    the buckets are rebuilt first if oam or the sprite size has changed since they were last built
+// input:
+//   ppu - ppu to function on
+//   eightSixteenSpriteFlag - whether the game is an 8x8 or 8x16 sprite game
+// output:
+//   oamIndices - output array of oam indices
+// return:
+//   amount of sprites found on the current scanline
+int spriteEvaluation(PPU* ppu, uint8_t* oamIndices, int eightSixteenSpriteFlag){
+  int spriteEvalCounter;
+
+  if(ppu->spriteLinesDirty == 1 || ppu->spriteLinesHeight != ((eightSixteenSpriteFlag == 1) ? 16 : 8)){
+    bucketSprites(ppu, eightSixteenSpriteFlag);
   }
 
-  return spriteEvalCounter;
+  if(ppu->scanLineSprites < 0 || ppu->scanLineSprites >= SPRITE_LINES){
+    return 0;
+  }
 
+  spriteEvalCounter = ppu->spriteLineCount[ppu->scanLineSprites];
 
-}
+  // more than 8 sprites on this scanline
+  if(spriteEvalCounter > 8){
+    ppu->status = setBit(ppu->status, 5);
+    spriteEvalCounter = 8;
+  }
 
+  memcpy(oamIndices, ppu->spriteLines[ppu->scanLineSprites], spriteEvalCounter);
 
+  return spriteEvalCounter;
 
-// TODO: implement dot based renderer
-void tickPpu(Bus* bus){
-  
 
 }
-// renderScanline()
-//   renders a scanline with the given registers 
-//   inputs:
-//     ppu - ppu to render a scanline with 
-//
 
-void renderScanline(PPU* ppu){
 
-  uint8_t attributeTableByte;
-  uint16_t patternTableIndice;
-  uint8_t bitPlane1 = 0;
-  uint8_t bitPlane2 = 0;
-  uint8_t bitLo;
-  uint8_t bitHi;
-  uint16_t bit1_16;
-  uint16_t bit2_16;
-  uint8_t bitsCombined;
-  uint8_t currentAttributeData;
-  uint16_t currentAttributeData1;
-  uint16_t currentAttributeData2;
-  uint16_t patternTableOffset = 0;
-  uint8_t spritePaletteIndex;
-  uint8_t bitsCombinedBackground = 0;
-  int spriteEvalCounter = 0;
-  int eightSixteenSpriteFlag;
-  uint16_t spritePatternTableOffset = 0;
-  uint8_t oamIndices[9];
-  uint8_t tempPalette[4]; 
-  uint16_t tempV;
 
-  if(getBit(ppu->ctrl, 4) == 0){
-    patternTableOffset = 0;
-  } else if (getBit(ppu->ctrl, 4) != 0){
-    patternTableOffset = 0x1000;
-  }
+// tickPpu()
+//   catches the ppu up to the cpu, running the dots of the current scanline up to now (see renderDots()).
+//   called before the cpu touches anything that changes what the ppu outputs, or reads something the ppu sets,
+//   so those happen on the right dot without the ppu having to be run every cycle
+void tickPpu(Bus* bus){
+  uint64_t now = bus->scheduler.clock + ((uint64_t)bus->cpu->cycles * MASTER_CYCLES_PER_CPU_CYCLE);
+  uint64_t dot;
 
-  if(getBit(ppu->ctrl, 3) == 0){
-      spritePatternTableOffset = 0;
-  } else if(getBit(ppu->ctrl, 3) != 0){
-      spritePatternTableOffset = 0x1000;
+  if(now <= bus->ppu->lineStart){
+    return;
   }
 
-  eightSixteenSpriteFlag = getEightSixteen(ppu);
-
-
-  // Sprite Evaluation
-  //   Does a linear search through the oam, find 8 sprites on the current scanline that are going to be drawn and
-  //   stores the found oam indices into an array
-  //   Sprite evalution does not occur on scanline 0, so we start the sprite scanline at -1 and increment from here.
-  //   (no sprites if scanlinesprites == -1)
-  if(ppu->scanLineSprites > -1){
-    spriteEvalCounter = spriteEvaluation(ppu, oamIndices, eightSixteenSpriteFlag);
+  dot = (now - bus->ppu->lineStart) / MASTER_CYCLES_PER_DOT;
+  renderDots(bus->ppu, dot > DOTS_PER_SCANLINE ? DOTS_PER_SCANLINE : (int)dot);
+}
+// planeSpread[b] holds the 8 bits of b, leftmost (bit 7) first, one bit per byte in memory order (little endian).
+// planeSpread[lo] | (planeSpread[hi] << 1) gives the 2-bit colours of 8 pixels of a tile at once
+// built at compile time so that instances started on different threads never write to it
+#define PLANE_BIT(b, j) ((uint64_t)(((b) >> (7 - (j))) & 1) << (8 * (j)))
+#define PLANE_SPREAD(b) (PLANE_BIT(b, 0) | PLANE_BIT(b, 1) | PLANE_BIT(b, 2) | PLANE_BIT(b, 3) \
+                         | PLANE_BIT(b, 4) | PLANE_BIT(b, 5) | PLANE_BIT(b, 6) | PLANE_BIT(b, 7))
+#define PLANE_SPREAD4(b) PLANE_SPREAD(b), PLANE_SPREAD((b) + 1), PLANE_SPREAD((b) + 2), PLANE_SPREAD((b) + 3)
+#define PLANE_SPREAD16(b) PLANE_SPREAD4(b), PLANE_SPREAD4((b) + 4), PLANE_SPREAD4((b) + 8), PLANE_SPREAD4((b) + 12)
+#define PLANE_SPREAD64(b) PLANE_SPREAD16(b), PLANE_SPREAD16((b) + 16), PLANE_SPREAD16((b) + 32), PLANE_SPREAD16((b) + 48)
+
+static const uint64_t planeSpread[256] = {
+  PLANE_SPREAD64(0), PLANE_SPREAD64(64), PLANE_SPREAD64(128), PLANE_SPREAD64(192)
+};
+
+
+// decodeChrTile()
+//   decodes one tile of a CHR bank into the bank's chrTiles
+void decodeChrTile(Mem* bank, int tile){
+  uint64_t pixels;
+  uint8_t* pattern = bank->contents + (tile << 4);
+
+  for(int row = 0; row < 8; ++row){
+    pixels = planeSpread[pattern[row]] | (planeSpread[pattern[row + 8]] << 1);
+    memcpy(bank->chrTiles + (tile << 6) + (row << 3), &pixels, 8);
   }
+  bank->chrTileDirty[tile] = 0;
+}
 
 
+// initChrCache()
+//   decodes every tile of every CHR bank once the rom has been loaded. the last two banks on the ppu bus are
+//   the nametables and aren't cached, banks that are written to later are re-decoded by chrRow()
+void initChrCache(PPU* ppu){
+  Mem* bank;
+  int tiles;
 
-  for(int i = 0; i < WINDOW_WIDTH; ++i){
-
-
-    
-    // if background rendering is enabled
-    if(getBit(ppu->mask, 3) == 0b1000){
-      // every tile, fetch the bitplanes from the nametable a tile ahead, to keep the buffer filled
-      if(i != 0 && i % 8 == 0){ 
-        fillTempV(&tempV, ppu->vregister.vcomp);
-        
-        //printf("vreg %x \n", tempV + 0x2000);
-        patternTableIndice = readPpuBus(ppu, 0x2000 + tempV);
-
-
-        // fetch lsb and msb bitplanes and fill shift register buffers
-        ppu->bitPlane1 = ppu->bitPlane1 | readPpuBus(ppu, patternTableOffset + (patternTableIndice << 4) + ppu->vregister.vcomp.fineY);
-        ppu->bitPlane2 = ppu->bitPlane2 | readPpuBus(ppu, patternTableOffset + (patternTableIndice << 4) + ppu->vregister.vcomp.fineY + 8);
-
-        attributeTableByte = readPpuBus(ppu, 0x23c0 | (tempV & 0x0c00) | ((tempV >> 4) & 0x38) | ((tempV >> 2) & 0x07));
-
-        // finds which quadrant V resides in and returns the appropriate 2-bit number from the byte
-        attributeTableByte = findAndReturnAttributeByte(tempV, attributeTableByte);
-
-        // copies it 8 times into the attribute table buffer (shift register)
-        for(int k = 0; k < 8; ++k){
-          if(getBit(attributeTableByte, 0) == 1){
-            ppu->attributeData1 = setBit16bit(ppu->attributeData1, k);
-          } else if(getBit(attributeTableByte, 0) == 0){
-            ppu->attributeData1 = clearBit16bit(ppu->attributeData1, k);
-          }
-
-          if(getBit(attributeTableByte, 1) == 0b10){
-            ppu->attributeData2 = setBit16bit(ppu->attributeData2, k);
-          } else if(getBit(attributeTableByte, 1) == 0){
-            ppu->attributeData2 = clearBit16bit(ppu->attributeData2, k);
-          }
-
-        }
-        incrementCourseX(ppu);
+  for(int i = 0; i < ppu->ppubus->numOfBlocks - 2; ++i){
+    bank = &(ppu->ppubus->memArr[i]);
+    if(bank->contents == NULL || bank->chrTiles != NULL){
+      continue;
+    }
 
-      }
+    tiles = bank->size >> 4;
+    bank->chrTiles = malloc(tiles * 64);
+    bank->chrTileDirty = malloc(tiles);
+    for(int j = 0; j < tiles; ++j){
+      decodeChrTile(bank, j);
+    }
+  }
+}
 
 
+// chrRow()
+//   returns the 8 decoded pixels (0-3, leftmost first) of the pattern table row at addr. bit 3 of addr,
+//   which picks the low or high bit plane, is ignored since both planes are decoded together
+uint8_t* chrRow(PPU* ppu, uint16_t addr){
+  uint16_t offset;
+  uint64_t pixels;
+  int tile;
+  Mem* bank = chrBank(ppu, addr, &offset);
+
+  // not cached, decode it from the ppu bus into chrRowScratch instead
+  if(bank == NULL || bank->chrTiles == NULL || offset >= bank->size){
+    pixels = planeSpread[readPpuBus(ppu, addr & ~0x8)] | (planeSpread[readPpuBus(ppu, addr | 0x8)] << 1);
+    memcpy(ppu->chrRowScratch, &pixels, 8);
+    return ppu->chrRowScratch;
+  }
 
-      // fetch data from shift registers for the current pixel
-      currentAttributeData1 = 0;
-      currentAttributeData1 = (getBitFromLeft16bit(ppu->attributeData1, ppu->xregister));
-      currentAttributeData1 = currentAttributeData1 >> findBit16bit(currentAttributeData1);
-      
-      currentAttributeData2 = 0;
-      currentAttributeData2 = (getBitFromLeft16bit(ppu->attributeData2, ppu->xregister));
-      currentAttributeData2 = currentAttributeData2 >> findBit16bit(currentAttributeData2);
-      currentAttributeData2 = currentAttributeData2 << 1;
-      
+  tile = offset >> 4;
+  if(bank->chrTileDirty[tile] == 1){
+    decodeChrTile(bank, tile);
+  }
+  return bank->chrTiles + (tile << 6) + ((offset & 0x7) << 3);
+}
 
-      currentAttributeData = currentAttributeData1 | currentAttributeData2;
 
-      // $3f00 is hard-wired to be the backdrop color
-      tempPalette[0] = readPpuBus(ppu, 0x3f00 + 0);
-      tempPalette[1] = readPpuBus(ppu, 0x3f00 + 1 + (currentAttributeData) * 4);
-      tempPalette[2] = readPpuBus(ppu, 0x3f00 + 2 + (currentAttributeData) * 4);
-      tempPalette[3] = readPpuBus(ppu, 0x3f00 + 3 + (currentAttributeData) * 4);
+// fetchBackgroundRow()
+//   fetches all of the background tiles on the current scanline, a whole tile at a time, into row.
+//   each byte of row is the palette index of one pixel (attribute * 4 + colour), starting with the two tiles
+//   already in the shift registers (see fetchFirstTwoTiles()). the pixel at x on screen is row[x + fineX]
+//   inputs:
+//     ppu - ppu to fetch with, v is incremented once per tile
+//     patternTableOffset - background pattern table, 0 or 0x1000
+//   output:
+//     row - BACKGROUND_ROW_TILES * 8 palette indices
+void fetchBackgroundRow(PPU* ppu, uint8_t* row, uint16_t patternTableOffset){
+  uint16_t tempV;
+  uint16_t patternTableIndice;
+  uint8_t attributeTableByte;
+  uint64_t pixels;
+
+  // the high byte of each shift register holds the first tile, the low byte the second
+  for(int tile = 0; tile < 2; ++tile){
+    int shift = 8 - (tile * 8);
+    pixels = planeSpread[(ppu->bitPlane1 >> shift) & 0xff] | (planeSpread[(ppu->bitPlane2 >> shift) & 0xff] << 1)
+           | (planeSpread[(ppu->attributeData1 >> shift) & 0xff] << 2) | (planeSpread[(ppu->attributeData2 >> shift) & 0xff] << 3);
+    memcpy(row + (tile * 8), &pixels, 8);
+  }
 
+  for(int tile = 2; tile < BACKGROUND_ROW_TILES; ++tile){
+    fillTempV(&tempV, ppu->vregister.vcomp);
+    patternTableIndice = readPpuBus(ppu, 0x2000 + tempV);
 
-      // shift the shift registers
-      ppu->attributeData1 = ppu->attributeData1 << 1;
-      ppu->attributeData2 = ppu->attributeData2 << 1;
+    // already decoded pixels of the tile's row
+    memcpy(&pixels, chrRow(ppu, patternTableOffset + (patternTableIndice << 4) + ppu->vregister.vcomp.fineY), 8);
 
+    // finds which quadrant V resides in and returns the appropriate 2-bit number from the byte
+    attributeTableByte = readPpuBus(ppu, 0x23c0 | (tempV & 0x0c00) | ((tempV >> 4) & 0x38) | ((tempV >> 2) & 0x07));
+    attributeTableByte = findAndReturnAttributeByte(tempV, attributeTableByte);
 
-      // using data from the shift register, get the two bits from the bitplanes from the end of the shift registers
-      bit1_16 = getBitFromLeft16bit(ppu->bitPlane1, ppu->xregister);
-      bit2_16 = getBitFromLeft16bit(ppu->bitPlane2, ppu->xregister);
-      bit1_16 = bit1_16 >> findBit16bit(bit1_16);
-      bit2_16 = bit2_16 >> findBit16bit(bit2_16);
-      bit2_16 = bit2_16 << 1;
-      bitsCombined = bit1_16 | bit2_16;
+    pixels = pixels | (0x0101010101010101ULL * (attributeTableByte << 2));
+    memcpy(row + (tile * 8), &pixels, 8);
 
-      // find 24Bit rgb value and set the pixel value to this
-      ppu->frameBuffer[ppu->scanLine][i] = ppu->palette[tempPalette[bitsCombined]];
+    incrementCourseX(ppu);
+  }
 
-      ppu->bitPlane1 = ppu->bitPlane1 << 1;
-      ppu->bitPlane2 = ppu->bitPlane2 << 1;
+  // the shift registers are left alone, fetchFirstTwoTiles() refills them at the end of the scanline
+}
 
 
-    // this is kept for later when checking for a sprite zero hit
-      bitsCombinedBackground = bitsCombined;
+// rasterizeSprites()
+//   draws the sprites found by spriteEvaluation() into a line buffer, one sprite row at a time.
+//   sprites earlier in oam are in front, so a sprite only fills the pixels that are still transparent
+//   inputs:
+//     oamIndices - oam indices of the sprites on this scanline, in oam order
+//     spriteCount - amount of sprites in oamIndices
+//     eightSixteenSpriteFlag - whether the game is an 8x8 or 8x16 sprite game
+//     spritePatternTableOffset - sprite pattern table for 8x8 sprites, 0 or 0x1000
+//   output:
+//     spriteLine - WINDOW_WIDTH + 8 entries, should be zeroed. each one is 0 for a transparent pixel, otherwise
+//                  the paletteCache index of the pixel's colour along with SPRITE_PIXEL_BEHIND and SPRITE_PIXEL_ZERO
+void rasterizeSprites(PPU* ppu, uint8_t* oamIndices, int spriteCount, int eightSixteenSpriteFlag, uint16_t spritePatternTableOffset, uint8_t* spriteLine){
+  uint8_t* sprite;
+  uint8_t* pixels;
+  uint8_t rowPixels[8];
+  uint64_t row;
+  int spriteRowNum;
+  uint8_t flags;
+
+  for(int j = 0; j < spriteCount; ++j){
+    sprite = ppu->oam + oamIndices[j];
+
+    // row of the sprite on this scanline, counted from the bottom if the sprite is vertically mirrored
+    spriteRowNum = ppu->scanLineSprites - sprite[0];
+    if(getBit(sprite[2], 7) != 0){
+      spriteRowNum = (eightSixteenSpriteFlag == 1 ? 15 : 7) - spriteRowNum;
+    }
 
-      
-    } else if(getBit(ppu->mask, 3) == 0){
-      bitsCombinedBackground = 0;
-      ppu->frameBuffer[ppu->scanLine][i] = ppu->palette[readPpuBus(ppu, 0x3f00 + 0)];
+    // sprite[1] is where the patterntable index resides in
+    if(eightSixteenSpriteFlag == 0){
+      pixels = chrRow(ppu, spritePatternTableOffset + (((uint16_t) sprite[1]) << 4) + spriteRowNum);
+    } else {
+      // 8x16 sprites take their pattern table from bit 0 of the index, and are the even tile on top of the odd tile after it
+      pixels = chrRow(ppu, (getBit(sprite[1], 0) * 0x1000) + ((((uint16_t) sprite[1] & 0xfe) + (spriteRowNum >> 3)) << 4) + (spriteRowNum & 0x7));
     }
 
+    // if the sprite is horizontally mirrored, reversing the 8 decoded pixels flips the row
+    if(getBit(sprite[2], 6) != 0){
+      memcpy(&row, pixels, 8);
+      row = __builtin_bswap64(row);
+      memcpy(rowPixels, &row, 8);
+      pixels = rowPixels;
+    }
 
-   
+    // sprite palettes start at $3f10
+    flags = 0x10 | ((sprite[2] & 0b11) << 2);
+    if(getBit(sprite[2], 5) != 0){
+      flags = flags | SPRITE_PIXEL_BEHIND;
+    }
+    if(oamIndices[j] == 0){
+      flags = flags | SPRITE_PIXEL_ZERO;
+    }
 
-    // if sprite rendering is enabled
-    if(getBit(ppu->mask, 4) != 0 && ppu->scanLineSprites > -1){
-    // Second, now iterate through the amount of sprites that were found from Sprite Evaluation and display them if the beam resides in it's X coordinate
-    for(int j = 0; j < spriteEvalCounter; ++j){
-
-      // if rendering 8x16 sprites, fetch the spriteOffset from byte 1 of the OAM as opposed to bit 5 of PPUCTRL
-      if(eightSixteenSpriteFlag == 1){
-        if(getBit(ppu->oam[oamIndices[j] + 1], 0) == 0){
-          spritePatternTableOffset = 0;
-        } else if(getBit(ppu->oam[oamIndices[j] + 1], 0) == 1){
-          spritePatternTableOffset = 0x1000;
-        }
+    // sprite[3] is the X coordinate of the sprite
+    for(int k = 0; k < 8; ++k){
+      if(pixels[k] != 0 && spriteLine[sprite[3] + k] == 0){
+        spriteLine[sprite[3] + k] = flags | pixels[k];
       }
+    }
+  }
+}
 
-      // + 3 because this gets the X coordinate of the tile
-      // if the beam is within the boundaries of foreground tile, draw the pixel
-      if(ppu->oam[oamIndices[j] + 3] <= i && ppu->oam[oamIndices[j] + 3] + 8 >= i){
- 
-
-       if(eightSixteenSpriteFlag == 0){
-
-
-          // if the sprite is vertically mirrored or not
-          if(getBit(ppu->oam[oamIndices[j] + 2], 7) == 0){ 
-
-          // oamIndices[j] + 1 because this is where the patterntable index resides in
-            bitPlane1 = readPpuBus(ppu, (spritePatternTableOffset + (((uint16_t) ppu->oam[oamIndices[j] + 1]) << 4) + ppu->scanLineSprites - ppu->oam[oamIndices[j]]));
-            bitPlane2 = readPpuBus(ppu, (spritePatternTableOffset + (((uint16_t) ppu->oam[oamIndices[j] + 1]) << 4) + ppu->scanLineSprites - ppu->oam[oamIndices[j]] + 8));    
-          } else if(getBit(ppu->oam[oamIndices[j] + 2], 7) == 0b10000000) {
-            bitPlane1 = readPpuBus(ppu, (spritePatternTableOffset + (((uint16_t) ppu->oam[oamIndices[j] + 1]) << 4) + (7 - (ppu->scanLineSprites - ppu->oam[oamIndices[j]]))));
-            bitPlane2 = readPpuBus(ppu, (spritePatternTableOffset + (((uint16_t) ppu->oam[oamIndices[j] + 1]) << 4) + (7 - (ppu->scanLineSprites - ppu->oam[oamIndices[j]]) + 8)));    
-          }
-
-        } else if(eightSixteenSpriteFlag == 1){
 
+// startLine()
+//   runs dot 0 of a rendered scanline: finds the sprites on it and draws them into the sprite line buffer.
+//   the background row is left to composeLine()
+static void startLine(PPU* ppu){
+  int spriteEvalCounter = 0;
+  int eightSixteenSpriteFlag = getEightSixteen(ppu);
+  uint16_t spritePatternTableOffset = (getBit(ppu->ctrl, 3) != 0) ? 0x1000 : 0;
+  uint8_t oamIndices[9];
 
-          // if the sprite is vertically mirrored or not
-          if(getBit(ppu->oam[oamIndices[j] + 2], 7) == 0){ 
-            if((ppu->scanLineSprites - ppu->oam[oamIndices[j]]) <= 7){
-              bitPlane1 = readPpuBus(ppu, (spritePatternTableOffset + (((((uint16_t) ppu->oam[oamIndices[j] + 1]) & 0xfe) >> 0) << 4) + ppu->scanLineSprites - ppu->oam[oamIndices[j]]));
-              bitPlane2 = readPpuBus(ppu, (spritePatternTableOffset + (((((uint16_t) ppu->oam[oamIndices[j] + 1]) & 0xfe) >> 0) << 4) + (ppu->scanLineSprites - ppu->oam[oamIndices[j]]) + 8));    
-            } else if((ppu->scanLineSprites - ppu->oam[oamIndices[j]]) > 7){
-              bitPlane1 = readPpuBus(ppu, (spritePatternTableOffset + ((((((uint16_t) ppu->oam[oamIndices[j] + 1]) & 0xfe) >> 0) + 1) << 4) + (ppu->scanLineSprites - ppu->oam[oamIndices[j]]) - 8));
-              bitPlane2 = readPpuBus(ppu, (spritePatternTableOffset + ((((((uint16_t) ppu->oam[oamIndices[j] + 1]) & 0xfe) >> 0) + 1) << 4) + (ppu->scanLineSprites - ppu->oam[oamIndices[j]])));    
-            }
+  ppu->lineStartV = ppu->vregister;
 
-          } else if(getBit(ppu->oam[oamIndices[j] + 2], 7) == 0b10000000) {
+  // Sprite Evaluation
+  //   Finds the (up to) 8 sprites on the current scanline that are going to be drawn, in oam order,
+  //   and draws them into a line buffer, even if sprites are disabled in case they're enabled part way through
+  //   Sprite evalution does not occur on scanline 0, so we start the sprite scanline at -1 and increment from here.
+  //   (no sprites if scanlinesprites == -1)
+  memset(ppu->lineSprites, 0, sizeof(ppu->lineSprites));
+  ppu->lineSpriteZero = 0;
+  if(ppu->scanLineSprites > -1){
+    spriteEvalCounter = spriteEvaluation(ppu, oamIndices, eightSixteenSpriteFlag);
+    ppu->lineSpriteZero = (spriteEvalCounter > 0 && oamIndices[0] == 0);
 
-            if((ppu->scanLineSprites - ppu->oam[oamIndices[j]]) <= 7){
-              bitPlane1 = readPpuBus(ppu, (spritePatternTableOffset + (((((uint16_t) ppu->oam[oamIndices[j] + 1]) & 0xfe) + 1) << 4) + (7 - (ppu->scanLineSprites - ppu->oam[oamIndices[j]]))));
-              bitPlane2 = readPpuBus(ppu, (spritePatternTableOffset + (((((uint16_t) ppu->oam[oamIndices[j] + 1]) & 0xfe) + 1) << 4) + (7 - ((ppu->scanLineSprites - ppu->oam[oamIndices[j]]) + 8))));      
-            } else if((ppu->scanLineSprites - ppu->oam[oamIndices[j]]) > 7){
-              bitPlane1 = readPpuBus(ppu, (spritePatternTableOffset + ((((uint16_t) ppu->oam[oamIndices[j] + 1]) & 0xfe) << 4) + (7 - ((ppu->scanLineSprites - ppu->oam[oamIndices[j]]) - 8))));
-              bitPlane2 = readPpuBus(ppu, (spritePatternTableOffset + ((((uint16_t) ppu->oam[oamIndices[j] + 1]) & 0xfe) << 4) + (7 - (ppu->scanLineSprites - ppu->oam[oamIndices[j]]))));    
-            }
+    // only sprite 0 matters on a skipped frame, see composeLine()
+    if(ppu->skipFrame == 0){
+      rasterizeSprites(ppu, oamIndices, spriteEvalCounter, eightSixteenSpriteFlag, spritePatternTableOffset, ppu->lineSprites);
+    } else if(ppu->lineSpriteZero == 1){
+      rasterizeSprites(ppu, oamIndices, 1, eightSixteenSpriteFlag, spritePatternTableOffset, ppu->lineSprites);
+    }
+  }
 
-          }
+  ppu->lineDirty = LINE_REFETCH;
+}
 
 
-        }
-        
-        // checks to see if the sprite horizontal mirroring bit is set
-        if(getBit(ppu->oam[oamIndices[j] + 2], 6) == 0b01000000){
-          bitLo = getBit(bitPlane1, i - ppu->oam[oamIndices[j] + 3]);
-          bitHi = getBit(bitPlane2, i - ppu->oam[oamIndices[j] + 3]);
-          bitLo = bitLo >> (i - ppu->oam[oamIndices[j] + 3]);
-          bitHi = bitHi >> (i - ppu->oam[oamIndices[j] + 3]);
-        } else {
-          bitLo = getBitFromLeft(bitPlane1, i - ppu->oam[oamIndices[j] + 3]);
-          bitHi = getBitFromLeft(bitPlane2, i - ppu->oam[oamIndices[j] + 3]);
-          bitLo = bitLo >> findBit(bitLo);
-          bitHi = bitHi >> findBit(bitHi);
-        }
+// composeLine()
+//   (re)builds the current scanline from pixel "from" on with the registers as they are now, fetching the background
+//   row again if LINE_REFETCH is set
+static void composeLine(PPU* ppu, int from){
+  static const uint8_t noSprites[WINDOW_WIDTH + 8];
+  uint8_t row[BACKGROUND_ROW_TILES * 8];
+  union VRegister v = ppu->vregister;
+  int keptTiles;
+
+  // nothing is drawn on a skipped frame, only what the game can see is worked out: sprite 0 hit, which only
+  // needs the background and sprite 0 and only when sprite 0 is on this scanline. the row is still fetched while
+  // a layer is disabled, the tiles already in the pipeline are kept if it gets enabled part way through the line
+  if(ppu->skipFrame == 1 && (ppu->lineSpriteZero == 0 || getBit(ppu->status, 6) != 0)){
+    ppu->lineHit = -1;
+    ppu->lineDirty = ppu->lineDirty & LINE_REFETCH;
+    return;
+  }
 
+  if((ppu->lineDirty & LINE_REFETCH) != 0){
+    // if background rendering is enabled, fetch every tile on this scanline
+    // v is put back afterwards, so what the cpu sees of it doesn't depend on when (or if) the row was fetched
+    if(getBit(ppu->mask, 3) != 0){
+      ppu->vregister = ppu->lineStartV;
+      fetchBackgroundRow(ppu, row, (getBit(ppu->ctrl, 4) != 0) ? 0x1000 : 0);
+      ppu->vregister = v;
+    } else {
+      memset(row, 0, sizeof(row));
+    }
 
+    // part way through the scanline, the tiles that had already been fetched stay as they were: the two from the
+    // end of the last scanline, and one more for every 8 dots up to and including the one being fetched
+    keptTiles = (ppu->dotx > 1) ? (ppu->dotx / 8) + 3 : 0;
+    keptTiles = keptTiles > BACKGROUND_ROW_TILES ? BACKGROUND_ROW_TILES : keptTiles;
+    memcpy(ppu->lineBackground + (keptTiles * 8), row + (keptTiles * 8), (BACKGROUND_ROW_TILES - keptTiles) * 8);
+  }
 
-        bitHi = bitHi << 1;
-        bitsCombined = bitHi | bitLo;
+  // the row is shifted by fine x scroll once, by starting fineX pixels into it
+  ppu->lineHit = compositeScanline(ppu->lineBackground + ppu->xregister, (getBit(ppu->mask, 4) != 0) ? ppu->lineSprites : noSprites,
+                                   ppu->lineIndices, from);
+  ppu->lineDirty = 0;
+}
 
-        // if the colour isn't a transparency pixel, draw the pixel
-        if(bitsCombined != 0){
 
-          // if the background is transparent or the sprite is behind the backgrond, draw the pixel
-          if(bitsCombinedBackground == 0 || getBit(ppu->oam[oamIndices[j] + 2], 5) == 0){
-          // fetch sprite palette index from oam memory and set palette
-            spritePaletteIndex = getBit(ppu->oam[oamIndices[j] + 2], 0);
-            spritePaletteIndex = spritePaletteIndex | getBit(ppu->oam[oamIndices[j] + 2], 1);
+// renderDots()
+//   runs the current scanline up to (not including) the given dot. on a rendered scanline pixel x comes out on
+//   dot x + 1, v is moved on to the next row on dot 257 and the first two tiles of the next scanline are fetched
+//   by dot 336. vblank and the prerender scanline are handled by their events instead (see scheduler.h)
+void renderDots(PPU* ppu, int dot){
+  int from;
+  int to;
+  uint16_t* line;
 
-            tempPalette[0] = readPpuBus(ppu, 0x3f10 + 0 + (spritePaletteIndex * 4));
-            tempPalette[1] = readPpuBus(ppu, 0x3f10 + 1 + (spritePaletteIndex * 4));
-            tempPalette[2] = readPpuBus(ppu, 0x3f10 + 2 + (spritePaletteIndex * 4));
-            tempPalette[3] = readPpuBus(ppu, 0x3f10 + 3 + (spritePaletteIndex * 4));
+  if(dot <= ppu->dotx){
+    return;
+  }
+  if(ppu->vblank != 0 || ppu->prerenderScanlineFlag != 0){
+    ppu->dotx = dot;
+    return;
+  }
 
-            ppu->frameBuffer[ppu->scanLine][i] = ppu->palette[tempPalette[bitsCombined]];
-          }
+  if(ppu->dotx == 0){
+    startLine(ppu);
+  }
 
-         // sprite zero hit detection
-          if(oamIndices[j] == 0 && bitsCombinedBackground != 0 && getBit(ppu->mask, 4) != 0 && getBit(ppu->status, 6) == 0 && i != 255){
-            ppu->status = setBit(ppu->status, 6);
-          }
-        }
+  from = ppu->dotx - 1;
+  from = from < 0 ? 0 : (from > WINDOW_WIDTH ? WINDOW_WIDTH : from);
+  to = dot - 1;
+  to = to > WINDOW_WIDTH ? WINDOW_WIDTH : to;
 
+  if(from < to){
+    if(ppu->lineDirty != 0){
+      composeLine(ppu, from);
+    }
 
-        // sprite priority implementation
-        //   break if the the current pixel's sprite is not transparent, not drawing any further pixels ontop of it and ending iterating 
-        //   through the sprites.
-        if(bitsCombined != 0){
-          break;
+    // find the palette index of each pixel and put it in the framebuffer
+    if(ppu->skipFrame == 0){
+      line = ppu->frameBuffer + (ppu->scanLine * WINDOW_WIDTH);
+      for(int i = from; i < to; ++i){
+        line[i] = ppu->paletteCache[ppu->lineIndices[i]];
+      }
+    }
 
-        }
+    // sprite zero hit detection
+    if(ppu->lineHit >= from && ppu->lineHit < to && getBit(ppu->status, 6) == 0){
+      ppu->status = setBit(ppu->status, 6);
     }
   }
-  }
-  }
 
   // if background rendering is enabled, increment v
-  if(getBit(ppu->mask, 3) != 0){
+  if(ppu->dotx <= 257 && dot > 257 && getBit(ppu->mask, 3) != 0){
     // hori(v) = hori(t)
     ppu->vregister.vcomp.courseX = ppu->tregister.vcomp.courseX;
     ppu->vregister.vcomp.nameTableSelect = getBit(ppu->vregister.vcomp.nameTableSelect, 1) | getBit(ppu->tregister.vcomp.nameTableSelect, 0);
 
     incrementY(ppu);
-  
-    // gets shift registers ready for next scanline; fetches the first two tiles of the next line
+  }
+
+  // gets shift registers ready for next scanline; fetches the first two tiles of the next line
+  if(ppu->dotx <= 336 && dot > 336 && getBit(ppu->mask, 3) != 0){
     fetchFirstTwoTiles(ppu);
   }
- 
+
+  ppu->dotx = dot;
+}
+
+
+// moveLineStart()
+//   called after v is written to through $2006. if that happens while the background of a scanline is being drawn,
+//   the rest of the scanline carries on from the new v. lineStartV is moved back by the tiles that have
+//   already been fetched this scanline, so the row fetched from it lines up with the pixels still to come.
+//   the tile being fetched when v is written finishes with the old v and moves it on, so the first new tile
+//   is the one after v
+void moveLineStart(PPU* ppu){
+  int tile;
+
+  if(ppu->dotx == 0 || ppu->dotx > WINDOW_WIDTH){
+    return;
+  }
+
+  // coarse x and the horizontal nametable bit count through 64 tiles together
+  tile = (ppu->vregister.vcomp.courseX | ((ppu->vregister.vcomp.nameTableSelect & 0b01) << 5)) - (ppu->dotx / 8);
+  tile = tile & 0x3f;
+
+  ppu->lineStartV = ppu->vregister;
+  ppu->lineStartV.vcomp.courseX = tile & 0x1f;
+  ppu->lineStartV.vcomp.nameTableSelect = (ppu->vregister.vcomp.nameTableSelect & 0b10) | (tile >> 5);
+  ppu->lineDirty = ppu->lineDirty | LINE_REFETCH;
+}
+
+
+// renderScanline()
+//   renders what's left of the current scanline and gets ready for the next one
+//   if ppu->skipFrame is set, no pixels are drawn but sprite 0 hit and sprite overflow are still set the same way
+//   inputs:
+//     ppu - ppu to render a scanline with 
+//
+
+void renderScanline(PPU* ppu){
+  renderDots(ppu, DOTS_PER_SCANLINE);
+  ppu->dotx = 0;
 }
 
 
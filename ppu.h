@@ -26,9 +26,35 @@
 #include "memory.h"
 #include "general.h"
 #include <stdint.h>
+#ifndef ERNES_HEADLESS
 #include <SDL2/SDL.h>
+#endif
 
 
+// scanline 240 is rendered as well before vblank starts, so the framebuffer has a row past the
+// visible 240 (and one more spare). only the first WINDOW_HEIGHT rows are shown
+#define FRAMEBUFFER_HEIGHT 242
+
+// sprite line buffer entries (see rasterizeSprites()), 0 is a transparent pixel
+#define SPRITE_PIXEL_COLOUR 0x1f
+#define SPRITE_PIXEL_BEHIND 0x20
+#define SPRITE_PIXEL_ZERO 0x40
+
+// scanlines that sprites are bucketed into, enough for any sprite y coordinate
+#define SPRITE_LINES 256
+
+// lineDirty flags. the background row has to be fetched again (scroll, pattern table, nametable or CHR changed),
+// or only merged again with the sprites (fine x or which layers are enabled changed)
+#define LINE_REFETCH 1
+#define LINE_RECOMPOSITE 2
+
+// palette indices in the framebuffer are 9 bits, the 6-bit nes colour in bits 0-5 and
+// PPUMASK's emphasis bits (red, green, blue) in bits 6-8
+#define PALETTE_INDICES 512
+#define PALETTE_EMPHASIS_SHIFT 6
+
+// tiles fetched per scanline, 32 on screen plus one more for fine x scroll
+#define BACKGROUND_ROW_TILES 33
 
 
 enum DeviceTypePPU {CHRRom, CHRRam, VRam};
@@ -81,6 +107,8 @@ typedef struct _PPU {
   // 3 - one screen, upper bank
   int mirroring;
   
+  // dots of the current scanline that have been run, 0 - DOTS_PER_SCANLINE. the ppu only runs when it's caught up
+  // to the cpu by tickPpu(), or at the end of the scanline
   int dotx;
   int scanLine;
 
@@ -91,6 +119,9 @@ typedef struct _PPU {
   // flag is set when the ppu is rendering the prerender scanline (scanline 261)
   int prerenderScanlineFlag;
 
+  // set while running a frame that won't be drawn (see nesMainLoop()), renderScanline() doesn't draw any pixels
+  int skipFrame;
+
   // CHR-ROM or RAM cartridge contents
   // 8192 array of bytes 
   uint8_t* chrrom;
@@ -102,6 +133,18 @@ typedef struct _PPU {
   // used for sprites
   uint8_t* oam;
 
+  // sprites bucketed by the scanline they're on, in oam order (see bucketSprites()).
+  // spriteLines holds the oam indices of the first 8 sprites on each line, spriteLineCount how many there are,
+  // or 9 if there are more than 8 (sprite overflow)
+  uint8_t spriteLines[SPRITE_LINES][8];
+  uint8_t spriteLineCount[SPRITE_LINES];
+
+  // set when oam is written to, so that the buckets get rebuilt before the next scanline is rendered
+  int spriteLinesDirty;
+
+  // sprite height the buckets were built for, 8 or 16
+  int spriteLinesHeight;
+
 
   PPUBus* ppubus;
 
@@ -150,15 +193,26 @@ typedef struct _PPU {
   // scanline buffer gets appended to the framebuffer at the end of each rendering cycle
   //
   // the framebuffer gets parsed to the screen when a complete frame is drawn
-  // (stores the 24-bit RGB value in an array)
-  // frameBuffer should be initialized as [WINDOW_HEIGHT][WINDOW_WIDTH]
-  uint32_t** frameBuffer;
+  // (stores the 9-bit palette index of each pixel, see PALETTE_INDICES. rgbLut turns them into RGB)
+  // frameBuffer is FRAMEBUFFER_HEIGHT rows of WINDOW_WIDTH pixels back to back,
+  // pixel (x, y) is at frameBuffer[(y * WINDOW_WIDTH) + x]
+  uint16_t* frameBuffer;
+
+  // decoded pattern table row handed out by chrRow() for CHR that isn't in the tile cache
+  uint8_t chrRowScratch[8];
 
   // nes palette to 24-bit RGB color
   // http://www.romdetectives.com/Wiki/index.php?title=NES_Palette
 
   uint32_t palette[0x40];
 
+  // RGB colour of every palette index, with the emphasis bits applied. built by buildRgbLut()
+  uint32_t rgbLut[PALETTE_INDICES];
+
+  // palette index of each entry of palette ram, with PPUMASK's greyscale and emphasis bits already applied.
+  // kept up to date by updatePaletteCache()
+  uint16_t paletteCache[32];
+
   int mapper;
 
   // used to select the bank for CNROM games
@@ -169,6 +223,28 @@ typedef struct _PPU {
   // they can be accessed in functions that only pass a PPU* pointer
   MMC1 mmc1Copy;
 
+  // master clock time the current scanline started at
+  uint64_t lineStart;
+
+  // the current scanline, set up on its first dot: the background row (see fetchBackgroundRow()), the sprite line
+  // buffer (see rasterizeSprites()), and the two merged together into paletteCache indices (see compositor.c)
+  uint8_t lineBackground[BACKGROUND_ROW_TILES * 8];
+  uint8_t lineSprites[WINDOW_WIDTH + 8];
+  uint8_t lineIndices[WINDOW_WIDTH];
+
+  // v as it was at the start of the scanline, the background row is fetched from this
+  union VRegister lineStartV;
+
+  // 1 if sprite 0 is on the current scanline
+  int lineSpriteZero;
+
+  // x of the pixel sprite 0 hits on in lineIndices, -1 if it doesn't
+  int lineHit;
+
+  // LINE_REFETCH and LINE_RECOMPOSITE, set when a register changes part way through the scanline.
+  // the rest of the scanline is redone with the new value, the pixels already drawn are left alone
+  int lineDirty;
+
 } PPU;
 
 void initPpu(PPU*, int);
@@ -194,20 +270,33 @@ void dmaTransfer(Bus*);
 void renderScanlineForeground(PPU*);
 
 int spriteEvaluation(PPU*, uint8_t*, int);
+void bucketSprites(PPU*, int);
+void rasterizeSprites(PPU*, uint8_t*, int, int, uint16_t, uint8_t*);
 
 int getEightSixteen(PPU*);
 
+#ifndef ERNES_HEADLESS
 // draws the completed framebuffer to screen in SDL
 void drawFrameBuffer(PPU*, SDL_Renderer*, SDL_Texture*);
+#endif
 
 
 void incrementCourseX(PPU*);
 void incrementY(PPU*);
 void fetchFirstTwoTiles(PPU*);
+void fetchBackgroundRow(PPU*, uint8_t*, uint16_t);
+void decodeChrTile(Mem*, int);
+void initChrCache(PPU*);
+uint8_t* chrRow(PPU*, uint16_t);
+void updatePaletteCache(PPU*);
+void buildRgbLut(PPU*);
+void convertFrameBuffer(PPU*, uint32_t*, int);
 
 void fillTempV(uint16_t*, struct VComponent); 
 void copyMmc1(MMC1*, MMC1*);
 
 void prerenderScanline(Bus*);
 
-void tickPpu(Bus*);
\ No newline at end of file
+void tickPpu(Bus*);
+void renderDots(PPU*, int);
+void moveLineStart(PPU*);
\ No newline at end of file
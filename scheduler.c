@@ -0,0 +1,96 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+
+#include <stdint.h>
+#include "scheduler.h"
+
+
+// updateNextEventTime()
+//   finds the earliest scheduled event. there are only a handful of events, so they're just scanned
+static void updateNextEventTime(Scheduler* scheduler){
+  scheduler->nextEventTime = EVENT_NEVER;
+  for(int i = 0; i < NUM_OF_EVENTS; ++i){
+    if(scheduler->eventTime[i] < scheduler->nextEventTime){
+      scheduler->nextEventTime = scheduler->eventTime[i];
+    }
+  }
+}
+
+
+// initScheduler()
+//   sets the clock to 0, the start of scanline 0, and schedules the ppu's events for the first frame
+void initScheduler(Scheduler* scheduler){
+  scheduler->clock = 0;
+  scheduler->nextEventTime = EVENT_NEVER;
+  for(int i = 0; i < NUM_OF_EVENTS; ++i){
+    scheduler->eventTime[i] = EVENT_NEVER;
+  }
+
+  scheduleEvent(scheduler, EVENT_SCANLINE, MASTER_CYCLES_PER_SCANLINE);
+  scheduleEvent(scheduler, EVENT_VBLANK_START, 241 * MASTER_CYCLES_PER_SCANLINE);
+  scheduleEvent(scheduler, EVENT_VBLANK_END, 261 * MASTER_CYCLES_PER_SCANLINE);
+  scheduleEvent(scheduler, EVENT_PRERENDER, MASTER_CYCLES_PER_FRAME);
+}
+
+
+// scheduleEvent()
+//   sets the master clock time an event is due at, replacing any time it was already scheduled for
+void scheduleEvent(Scheduler* scheduler, int event, uint64_t time){
+  scheduler->eventTime[event] = time;
+  if(time < scheduler->nextEventTime){
+    scheduler->nextEventTime = time;
+  } else {
+    updateNextEventTime(scheduler);
+  }
+}
+
+
+void cancelEvent(Scheduler* scheduler, int event){
+  scheduler->eventTime[event] = EVENT_NEVER;
+  updateNextEventTime(scheduler);
+}
+
+
+// popEvent()
+//   unschedules and returns the first event that is due by the current clock, in EventType order if more than
+//   one is due at the same time. returns -1 if nothing is due yet
+//   output:
+//     time - when the event was due, for scheduling it again relative to that rather than to the clock
+int popEvent(Scheduler* scheduler, uint64_t* time){
+  int event = -1;
+
+  if(scheduler->nextEventTime > scheduler->clock){
+    return -1;
+  }
+
+  for(int i = 0; i < NUM_OF_EVENTS; ++i){
+    if(scheduler->eventTime[i] <= scheduler->clock && (event == -1 || scheduler->eventTime[i] < scheduler->eventTime[event])){
+      event = i;
+    }
+  }
+
+  *time = scheduler->eventTime[event];
+  cancelEvent(scheduler, event);
+  return event;
+}
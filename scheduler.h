@@ -0,0 +1,82 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+
+#pragma once
+#include <stdint.h>
+
+// scheduler.h
+//   keeps the time of everything that happens at a fixed point in a frame (the end of each scanline, vblank,
+//   the prerender scanline, and mapper irqs later on) on the master clock, so the cpu can be run up to the next
+//   one in a single batch. see runScanline() in main.c
+
+
+// ntsc master clock, 21.477272 MHz. a cpu cycle is 12 master cycles and a ppu dot is 4
+#define MASTER_CYCLES_PER_CPU_CYCLE 12
+#define MASTER_CYCLES_PER_DOT 4
+
+// 341 dots, 113 2/3 cpu cycles
+#define DOTS_PER_SCANLINE 341
+#define MASTER_CYCLES_PER_SCANLINE (DOTS_PER_SCANLINE * MASTER_CYCLES_PER_DOT)
+
+#define SCANLINES_PER_FRAME 262
+#define MASTER_CYCLES_PER_FRAME ((uint64_t)SCANLINES_PER_FRAME * MASTER_CYCLES_PER_SCANLINE)
+
+// events that are due at the same time are handled in this order
+enum EventType {
+  // end of a scanline, rendered by renderScanline()
+  EVENT_SCANLINE,
+
+  // end of scanline 240, vblankStart()
+  EVENT_VBLANK_START,
+
+  // end of scanline 260, vblankEnd()
+  EVENT_VBLANK_END,
+
+  // end of the prerender scanline (261), prerenderScanline()
+  EVENT_PRERENDER,
+
+  // for mappers with a cpu cycle counter irq, not scheduled by any of the mappers so far
+  EVENT_MAPPER_IRQ,
+
+  NUM_OF_EVENTS
+};
+
+#define EVENT_NEVER UINT64_MAX
+
+typedef struct _Scheduler {
+  // master cycles since power on
+  uint64_t clock;
+
+  // when each event is due, EVENT_NEVER if it isn't scheduled
+  uint64_t eventTime[NUM_OF_EVENTS];
+
+  // earliest of eventTime, the cpu runs until the clock reaches it
+  uint64_t nextEventTime;
+} Scheduler;
+
+
+void initScheduler(Scheduler*);
+void scheduleEvent(Scheduler*, int, uint64_t);
+void cancelEvent(Scheduler*, int);
+int popEvent(Scheduler*, uint64_t*);
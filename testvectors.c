@@ -0,0 +1,346 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cjson/cJSON.h>
+#include "testvectors.h"
+
+
+// size of the fixed part of a test, everything after the name and before the ram entries
+#define TEST_HEADER_SIZE (7 + 2 + 7 + 2 + 2)
+
+
+// growable buffer used while converting
+typedef struct _TestBuffer {
+  uint8_t* data;
+  size_t size;
+  size_t capacity;
+} TestBuffer;
+
+static void appendByte(TestBuffer* buffer, uint8_t val){
+  if(buffer->size == buffer->capacity){
+    buffer->capacity = buffer->capacity == 0 ? 4096 : buffer->capacity * 2;
+    buffer->data = realloc(buffer->data, buffer->capacity);
+  }
+  buffer->data[buffer->size++] = val;
+}
+
+static void append16(TestBuffer* buffer, uint16_t val){
+  appendByte(buffer, val & 0xff);
+  appendByte(buffer, val >> 8);
+}
+
+static void append32(TestBuffer* buffer, uint32_t val){
+  append16(buffer, val & 0xffff);
+  append16(buffer, val >> 16);
+}
+
+static uint16_t read16(const uint8_t* data){
+  return data[0] | (data[1] << 8);
+}
+
+static uint32_t read32(const uint8_t* data){
+  return read16(data) | ((uint32_t)read16(data + 2) << 16);
+}
+
+
+static int jsonInt(cJSON* json, const char* name){
+  cJSON* item = cJSON_GetObjectItemCaseSensitive(json, name);
+  return item != NULL ? item->valueint : 0;
+}
+
+static void appendState(TestBuffer* buffer, cJSON* json){
+  append16(buffer, jsonInt(json, "pc"));
+  appendByte(buffer, jsonInt(json, "s"));
+  appendByte(buffer, jsonInt(json, "a"));
+  appendByte(buffer, jsonInt(json, "x"));
+  appendByte(buffer, jsonInt(json, "y"));
+  appendByte(buffer, jsonInt(json, "p"));
+}
+
+static void appendRam(TestBuffer* buffer, cJSON* ram){
+  cJSON* entry;
+  cJSON_ArrayForEach(entry, ram){
+    append16(buffer, entry->child->valueint);
+    appendByte(buffer, entry->child->next->valueint);
+  }
+}
+
+
+// convertJsonToBuffer()
+//   converts the contents of a json test file into the binary format.
+//   returns 0 if the json couldn't be parsed
+static int convertJsonToBuffer(char* jsonText, TestBuffer* buffer){
+  cJSON* jsonData = cJSON_Parse(jsonText);
+  cJSON* test;
+  cJSON* initial;
+  cJSON* final;
+  cJSON* cycles;
+  cJSON* cycle;
+  cJSON* name;
+  size_t nameLength;
+  int numOfTests = 0;
+
+  if(jsonData == NULL){
+    return 0;
+  }
+
+  for(int i = 0; i < 4; ++i){
+    appendByte(buffer, TEST_VECTORS_MAGIC[i]);
+  }
+  append32(buffer, TEST_VECTORS_VERSION);
+  // number of tests gets filled in at the end
+  append32(buffer, 0);
+
+  cJSON_ArrayForEach(test, jsonData){
+    name = cJSON_GetObjectItemCaseSensitive(test, "name");
+    initial = cJSON_GetObjectItemCaseSensitive(test, "initial");
+    final = cJSON_GetObjectItemCaseSensitive(test, "final");
+    cycles = cJSON_GetObjectItemCaseSensitive(test, "cycles");
+
+    nameLength = (name != NULL && name->valuestring != NULL) ? strlen(name->valuestring) : 0;
+    if(nameLength > 0xff){
+      nameLength = 0xff;
+    }
+    appendByte(buffer, nameLength);
+    for(size_t i = 0; i < nameLength; ++i){
+      appendByte(buffer, name->valuestring[i]);
+    }
+
+    appendState(buffer, initial);
+    append16(buffer, cJSON_GetArraySize(cJSON_GetObjectItemCaseSensitive(initial, "ram")));
+    appendState(buffer, final);
+    append16(buffer, cJSON_GetArraySize(cJSON_GetObjectItemCaseSensitive(final, "ram")));
+    append16(buffer, cJSON_GetArraySize(cycles));
+
+    appendRam(buffer, cJSON_GetObjectItemCaseSensitive(initial, "ram"));
+    appendRam(buffer, cJSON_GetObjectItemCaseSensitive(final, "ram"));
+    cJSON_ArrayForEach(cycle, cycles){
+      append16(buffer, cycle->child->valueint);
+      appendByte(buffer, cycle->child->next->valueint);
+      appendByte(buffer, strcmp(cycle->child->next->next->valuestring, "write") == 0);
+    }
+    numOfTests++;
+  }
+
+  buffer->data[8] = numOfTests & 0xff;
+  buffer->data[9] = (numOfTests >> 8) & 0xff;
+  buffer->data[10] = (numOfTests >> 16) & 0xff;
+  buffer->data[11] = (numOfTests >> 24) & 0xff;
+
+  cJSON_Delete(jsonData);
+  return 1;
+}
+
+
+// readTextFile()
+//   reads a whole file into a NUL terminated buffer on the heap. returns NULL if it can't be opened
+static char* readTextFile(char* file){
+  FILE* fptr = fopen(file, "r");
+  long fileLength;
+  char* contents;
+
+  if(fptr == NULL){
+    return NULL;
+  }
+  fseek(fptr, 0L, SEEK_END);
+  fileLength = ftell(fptr);
+  fseek(fptr, 0L, SEEK_SET);
+
+  contents = malloc(fileLength + 1);
+  (void)!fread(contents, sizeof(char), fileLength, fptr);
+  contents[fileLength] = '\0';
+  fclose(fptr);
+  return contents;
+}
+
+
+// openTestVectors()
+//   opens a test file, either one in the binary format or a json file which gets converted on the fly.
+//   returns 1 on success, 0 if the file is malformed and -1 if it can't be opened
+int openTestVectors(TestVectors* vectors, char* file){
+  struct stat fileStat;
+  char magic[4];
+  int fd;
+  char* jsonText;
+  TestBuffer buffer = {NULL, 0, 0};
+
+  fd = open(file, O_RDONLY);
+  if(fd < 0){
+    return -1;
+  }
+  if(fstat(fd, &fileStat) != 0){
+    close(fd);
+    return -1;
+  }
+
+  if(fileStat.st_size >= 12 && read(fd, magic, 4) == 4 && memcmp(magic, TEST_VECTORS_MAGIC, 4) == 0){
+    vectors->data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(vectors->data == MAP_FAILED){
+      return -1;
+    }
+    vectors->size = fileStat.st_size;
+    vectors->mapped = 1;
+  } else {
+    close(fd);
+    jsonText = readTextFile(file);
+    if(jsonText == NULL){
+      return -1;
+    }
+    if(convertJsonToBuffer(jsonText, &buffer) == 0){
+      free(jsonText);
+      free(buffer.data);
+      return 0;
+    }
+    free(jsonText);
+    vectors->data = buffer.data;
+    vectors->size = buffer.size;
+    vectors->mapped = 0;
+  }
+
+  if(read32(vectors->data + 4) != TEST_VECTORS_VERSION){
+    printf("%s: unsupported test file version %d \n", file, read32(vectors->data + 4));
+    closeTestVectors(vectors);
+    return 0;
+  }
+  vectors->numOfTests = read32(vectors->data + 8);
+  vectors->offset = 12;
+  vectors->testsRead = 0;
+  return 1;
+}
+
+
+// nextTestVector()
+//   reads the next test in the file into vector.
+//   returns 1 if there was one, 0 once all of the tests have been read and -1 if the file is cut short
+int nextTestVector(TestVectors* vectors, TestVector* vector){
+  const uint8_t* data = vectors->data + vectors->offset;
+  size_t remaining = vectors->size - vectors->offset;
+  size_t length;
+
+  if(vectors->testsRead == vectors->numOfTests){
+    return 0;
+  }
+  if(remaining < 1 || remaining < 1 + (size_t)data[0] + TEST_HEADER_SIZE){
+    return -1;
+  }
+
+  vector->nameLength = data[0];
+  vector->name = (const char*)data + 1;
+  data += 1 + vector->nameLength;
+
+  vector->initial.pc = read16(data);
+  vector->initial.s = data[2];
+  vector->initial.a = data[3];
+  vector->initial.x = data[4];
+  vector->initial.y = data[5];
+  vector->initial.p = data[6];
+  vector->numOfInitRam = read16(data + 7);
+  data += 9;
+
+  vector->final.pc = read16(data);
+  vector->final.s = data[2];
+  vector->final.a = data[3];
+  vector->final.x = data[4];
+  vector->final.y = data[5];
+  vector->final.p = data[6];
+  vector->numOfFinalRam = read16(data + 7);
+  vector->numOfCycles = read16(data + 9);
+  data += 11;
+
+  length = 1 + vector->nameLength + TEST_HEADER_SIZE + (vector->numOfInitRam + vector->numOfFinalRam) * TEST_RAM_ENTRY_SIZE +
+           vector->numOfCycles * TEST_CYCLE_ENTRY_SIZE;
+  if(length > remaining){
+    return -1;
+  }
+
+  vector->initRam = data;
+  vector->finalRam = vector->initRam + vector->numOfInitRam * TEST_RAM_ENTRY_SIZE;
+  vector->cycles = vector->finalRam + vector->numOfFinalRam * TEST_RAM_ENTRY_SIZE;
+
+  vectors->offset += length;
+  vectors->testsRead++;
+  return 1;
+}
+
+
+void closeTestVectors(TestVectors* vectors){
+  if(vectors->mapped == 1){
+    munmap(vectors->data, vectors->size);
+  } else {
+    free(vectors->data);
+  }
+  vectors->data = NULL;
+  vectors->size = 0;
+}
+
+
+// convertJsonTests()
+//   converts a json test file into the binary format, to be read back with openTestVectors().
+//   returns 1 on success
+int convertJsonTests(char* jsonFile, char* binFile){
+  TestBuffer buffer = {NULL, 0, 0};
+  char* jsonText = readTextFile(jsonFile);
+  FILE* fptr;
+
+  if(jsonText == NULL){
+    printf("%s: cannot open file \n", jsonFile);
+    return 0;
+  }
+  if(convertJsonToBuffer(jsonText, &buffer) == 0){
+    printf("%s: not a valid test file \n", jsonFile);
+    free(jsonText);
+    return 0;
+  }
+  free(jsonText);
+
+  fptr = fopen(binFile, "wb");
+  if(fptr == NULL){
+    printf("%s: cannot create file \n", binFile);
+    free(buffer.data);
+    return 0;
+  }
+  fwrite(buffer.data, 1, buffer.size, fptr);
+  fclose(fptr);
+  free(buffer.data);
+  return 1;
+}
+
+
+// testRamAddr(), testRamValue()
+//   the address and value of entry i of a ram list
+uint16_t testRamAddr(const uint8_t* ram, int i){
+  return read16(ram + i * TEST_RAM_ENTRY_SIZE);
+}
+
+uint8_t testRamValue(const uint8_t* ram, int i){
+  return ram[i * TEST_RAM_ENTRY_SIZE + 2];
+}
@@ -0,0 +1,102 @@
+/*
+
+    ernes, a Nintendo Entertainment System emulator
+    Copyright (C) 2026  Cameron Kelly
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+
+*/
+
+
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// testvectors.h
+//   a compact binary format for Tom Harte's processor tests, so that they don't have to be parsed
+//   from json on every run. the binary files are mmap'd and read in place.
+//
+//   layout (everything little endian):
+//     header:   "ERNT", 4 byte version, 4 byte number of tests
+//     per test: 1 byte name length, name (not NUL terminated)
+//               initial state - 2 byte pc, s, a, x, y, p
+//               2 byte number of initial ram entries
+//               final state - same as the initial state
+//               2 byte number of final ram entries
+//               2 byte number of cycles
+//               initial ram entries - 2 byte address, value
+//               final ram entries - 2 byte address, value
+//               cycles - 2 byte address, value, 1 for a write or 0 for a read
+
+#define TEST_VECTORS_MAGIC "ERNT"
+#define TEST_VECTORS_VERSION 1
+
+// bytes in each ram entry and cycle
+#define TEST_RAM_ENTRY_SIZE 3
+#define TEST_CYCLE_ENTRY_SIZE 4
+
+
+typedef struct _TestState {
+  uint16_t pc;
+  uint8_t s;
+  uint8_t a;
+  uint8_t x;
+  uint8_t y;
+  uint8_t p;
+} TestState;
+
+
+// a single test, pointing into the file it was read from
+typedef struct _TestVector {
+  const char* name;
+  int nameLength;
+
+  TestState initial;
+  TestState final;
+
+  int numOfInitRam;
+  int numOfFinalRam;
+  int numOfCycles;
+  const uint8_t* initRam;
+  const uint8_t* finalRam;
+  const uint8_t* cycles;
+} TestVector;
+
+
+typedef struct _TestVectors {
+  uint8_t* data;
+  size_t size;
+
+  // 1 if data is mmap'd, 0 if it was converted from json into a buffer
+  int mapped;
+
+  int numOfTests;
+  int testsRead;
+
+  // where the next test starts
+  size_t offset;
+} TestVectors;
+
+
+int openTestVectors(TestVectors*, char*);
+int nextTestVector(TestVectors*, TestVector*);
+void closeTestVectors(TestVectors*);
+
+int convertJsonTests(char*, char*);
+
+uint16_t testRamAddr(const uint8_t*, int);
+uint8_t testRamValue(const uint8_t*, int);